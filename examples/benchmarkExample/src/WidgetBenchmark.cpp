@@ -0,0 +1,487 @@
+#include "WidgetBenchmark.h"
+#include "ofEvents.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <deque>
+
+using namespace std;
+
+// ----------------------------------------------------------------------
+
+namespace {
+
+	typedef std::chrono::steady_clock Clock;
+
+	// callbacks write here, so that the compiler can't optimise them away
+	volatile uint64_t sCallbackSink = 0;
+
+	// ----------------------------------------------------------------------
+	// time fn_, which performs numOps_ operations, return ns per operation.
+	template<typename Fn>
+	double timeOps(size_t numOps_, Fn fn_) {
+		auto t0 = Clock::now();
+		fn_();
+		auto t1 = Clock::now();
+		return std::chrono::duration<double, std::nano>(t1 - t0).count() / double(std::max<size_t>(numOps_, 1));
+	}
+
+	// ----------------------------------------------------------------------
+
+	void sendMouseEvent(ofCoreEvents& events_, ofMouseEventArgs::Type type_, float x_, float y_) {
+		ofMouseEventArgs args(type_, x_, y_, 0);
+		switch (type_) {
+		case ofMouseEventArgs::Pressed:
+			ofNotifyEvent(events_.mousePressed, args);
+			break;
+		case ofMouseEventArgs::Released:
+			ofNotifyEvent(events_.mouseReleased, args);
+			break;
+		case ofMouseEventArgs::Dragged:
+			ofNotifyEvent(events_.mouseDragged, args);
+			break;
+		default:
+			ofNotifyEvent(events_.mouseMoved, args);
+			break;
+		}
+	}
+
+	// ----------------------------------------------------------------------
+
+	void sendTouchEvent(ofCoreEvents& events_, ofTouchEventArgs::Type type_, int id_, float x_, float y_) {
+		ofTouchEventArgs args;
+		args.type = type_;
+		args.id = id_;
+		args.set(x_, y_);
+		switch (type_) {
+		case ofTouchEventArgs::down:
+			ofNotifyEvent(events_.touchDown, args);
+			break;
+		case ofTouchEventArgs::up:
+			ofNotifyEvent(events_.touchUp, args);
+			break;
+		default:
+			ofNotifyEvent(events_.touchMoved, args);
+			break;
+		}
+	}
+
+} // end anonymous namespace
+
+// ----------------------------------------------------------------------
+
+WidgetBenchmark::WidgetBenchmark(const Settings& settings_)
+	: mSettings(settings_)
+	, mRng(settings_.seed)
+	, mContext(ofxWidgetContext::make())
+{
+	mContext->listenTo(mEvents);
+}
+
+// ----------------------------------------------------------------------
+
+const std::vector<std::string>& WidgetBenchmark::getOperationNames() {
+	static const std::vector<std::string> names = {
+		"make",
+		"setParent",
+		"update",
+		"draw",
+		"mouseMoved",
+		"mouseJitter",
+		"mousePressed",
+		"touchMoved",
+		"touchJitter",
+		"bringToFront",
+		"raiseLeaf",
+		"moveBy",
+		"dragWindow",
+		"containsFocus",
+		"destroy",
+		"makeTree",
+		"destroyTree",
+	};
+	return names;
+}
+
+// ----------------------------------------------------------------------
+
+std::vector<WidgetBenchmark::Result> WidgetBenchmark::run() {
+
+	// the benchmark gets a widget context of its own, so that it 
+	// doesn't mess with (or get slowed down by) any app widgets.
+	ofxWidgetContext::Scope scope(*mContext);
+
+	ofxWidget::setHitTestGrid(mSettings.gridCellSize > 0.f, mSettings.gridCellSize);
+
+	std::vector<Result> results;
+
+	for (size_t i = mSettings.numSteps; i > 0; --i) {
+		auto numWidgets = mSettings.numWidgets >> (i - 1);
+		if (numWidgets == 0)
+			continue;
+		results.push_back(runScene(numWidgets));
+	}
+
+	return results;
+}
+
+// ----------------------------------------------------------------------
+
+void WidgetBenchmark::generateScene(size_t numWidgets_) {
+
+	// we build trees breadth first, each widget having up to fanOut 
+	// children, and trees being up to depth levels deep. once a tree 
+	// is full, we start a new tree.
+
+	mRects.clear();
+	mParents.clear();
+
+	std::uniform_real_distribution<float> unit(0.f, 1.f);
+
+	struct Node {
+		int index;
+		size_t depth;
+	};
+
+	std::deque<Node> open;
+
+	while (mRects.size() < numWidgets_) {
+
+		if (open.empty()) {
+			// start a new tree, with a root somewhere on a 1920x1080 screen.
+			float w = 100.f + 300.f * unit(mRng);
+			float h = 100.f + 300.f * unit(mRng);
+			mRects.emplace_back((1920.f - w) * unit(mRng), (1080.f - h) * unit(mRng), w, h);
+			mParents.push_back(-1);
+			open.push_back({ int(mRects.size() - 1), 0 });
+			continue;
+		}
+
+		auto parent = open.front();
+		open.pop_front();
+
+		if (parent.depth >= mSettings.depth)
+			continue;
+
+		for (size_t i = 0; i < mSettings.fanOut && mRects.size() < numWidgets_; ++i) {
+			// children are placed inside their parent's rect
+			const auto & p = mRects[parent.index];
+			float w = p.width * (0.1f + 0.4f * unit(mRng));
+			float h = p.height * (0.1f + 0.4f * unit(mRng));
+			mRects.emplace_back(p.x + (p.width - w) * unit(mRng), p.y + (p.height - h) * unit(mRng), w, h);
+			mParents.push_back(parent.index);
+			open.push_back({ int(mRects.size() - 1), parent.depth + 1 });
+		}
+	}
+}
+
+// ----------------------------------------------------------------------
+
+WidgetBenchmark::Result WidgetBenchmark::runScene(size_t numWidgets_) {
+
+	Result result;
+	result.numWidgets = numWidgets_;
+
+	generateScene(numWidgets_);
+
+	auto numOps = mSettings.numOps;
+	auto numFrames = mSettings.numFrames;
+
+	std::uniform_int_distribution<size_t> anyWidget(0, numWidgets_ - 1);
+	std::uniform_real_distribution<float> screenX(0.f, 1920.f);
+	std::uniform_real_distribution<float> screenY(0.f, 1080.f);
+	std::uniform_real_distribution<float> jitter(-2.f, 2.f);
+
+	// --- make
+
+	mWidgets.clear();
+	mWidgets.reserve(numWidgets_);
+
+	result.nsPerOp["make"] = timeOps(numWidgets_, [&]() {
+		for (const auto & r : mRects) {
+			mWidgets.push_back(ofxWidget::make(r));
+		}
+	});
+
+	// --- setParent
+
+	size_t numParented = std::count_if(mParents.begin(), mParents.end(), [](int p) { return p >= 0; });
+
+	result.nsPerOp["setParent"] = timeOps(numParented, [&]() {
+		for (size_t i = 0; i < mWidgets.size(); ++i) {
+			if (mParents[i] >= 0)
+				mWidgets[i]->setParent(mWidgets[mParents[i]]);
+		}
+	});
+
+	for (auto & w : mWidgets) {
+		w->onUpdate = []() { sCallbackSink = sCallbackSink + 1; };
+		w->onDraw = []() { sCallbackSink = sCallbackSink + 1; };
+		w->onMouse = [](ofMouseEventArgs& args_) { sCallbackSink = sCallbackSink + uint64_t(args_.x); };
+		w->onTouch = [](ofTouchEventArgs& args_) { sCallbackSink = sCallbackSink + uint64_t(args_.x); };
+	}
+
+	// --- update and draw passes
+
+	result.nsPerOp["update"] = timeOps(numFrames, [&]() {
+		for (size_t i = 0; i < numFrames; ++i)
+			ofxWidget::update();
+	});
+
+	result.nsPerOp["draw"] = timeOps(numFrames, [&]() {
+		for (size_t i = 0; i < numFrames; ++i)
+			ofxWidget::draw();
+	});
+
+	// --- mouse event dispatch
+
+	std::vector<ofVec2f> points(numOps);
+	for (auto & p : points) {
+		p.set(screenX(mRng), screenY(mRng));
+	}
+
+	result.nsPerOp["mouseMoved"] = timeOps(numOps, [&]() {
+		for (const auto & p : points)
+			sendMouseEvent(mEvents, ofMouseEventArgs::Moved, p.x + jitter(mRng), p.y + jitter(mRng));
+	});
+
+	// most mouse moves are small jitters around where the mouse was 
+	// before: we move around each point 16 times, by a pixel or two.
+	result.nsPerOp["mouseJitter"] = timeOps(numOps, [&]() {
+		for (size_t i = 0; i < numOps; ++i) {
+			const auto & p = points[i / 16];
+			sendMouseEvent(mEvents, ofMouseEventArgs::Moved, p.x + jitter(mRng), p.y + jitter(mRng));
+		}
+	});
+
+	// presses go to widget centers, so that they cause focus changes and reordering.
+	for (auto & p : points) {
+		const auto & r = mRects[anyWidget(mRng)];
+		p.set(r.x + r.width * 0.5f, r.y + r.height * 0.5f);
+	}
+
+	result.nsPerOp["mousePressed"] = timeOps(numOps, [&]() {
+		for (const auto & p : points) {
+			sendMouseEvent(mEvents, ofMouseEventArgs::Pressed, p.x, p.y);
+			sendMouseEvent(mEvents, ofMouseEventArgs::Released, p.x, p.y);
+		}
+	});
+
+	// --- touch event dispatch
+
+	// a crowded touch table: 40 touches, which all move every frame.
+	// touches get dispatched from within update(), so we time whole 
+	// frames, and take away what a frame without touches costs.
+	{
+		const int numTouches = 40;
+		size_t numTouchFrames = std::max<size_t>(numOps / numTouches, 1);
+
+		for (int t = 0; t < numTouches; ++t) {
+			const auto & r = mRects[anyWidget(mRng)];
+			sendTouchEvent(mEvents, ofTouchEventArgs::down, t, r.x + r.width * 0.5f, r.y + r.height * 0.5f);
+		}
+		ofxWidget::update();
+
+		std::vector<ofVec2f> touchPoints(numTouchFrames * numTouches);
+		for (auto & p : touchPoints) {
+			p.set(screenX(mRng), screenY(mRng));
+		}
+
+		auto nsPerFrame = timeOps(numTouchFrames, [&]() {
+			for (size_t i = 0; i < numTouchFrames; ++i)
+				ofxWidget::update();
+		});
+
+		auto nsPerTouchFrame = timeOps(numTouchFrames, [&]() {
+			for (size_t i = 0; i < numTouchFrames; ++i) {
+				for (int t = 0; t < numTouches; ++t) {
+					const auto & p = touchPoints[i * numTouches + t];
+					sendTouchEvent(mEvents, ofTouchEventArgs::move, t, p.x, p.y);
+				}
+				ofxWidget::update();
+			}
+		});
+
+		result.nsPerOp["touchMoved"] = std::max(nsPerTouchFrame - nsPerFrame, 0.) / numTouches;
+
+		// fingers on a table mostly jitter, too: each touch moves
+		// around its point 16 frames in a row, by a pixel or two.
+		nsPerTouchFrame = timeOps(numTouchFrames, [&]() {
+			for (size_t i = 0; i < numTouchFrames; ++i) {
+				for (int t = 0; t < numTouches; ++t) {
+					const auto & p = touchPoints[(i / 16) * numTouches + t];
+					sendTouchEvent(mEvents, ofTouchEventArgs::move, t, p.x + jitter(mRng), p.y + jitter(mRng));
+				}
+				ofxWidget::update();
+			}
+		});
+
+		result.nsPerOp["touchJitter"] = std::max(nsPerTouchFrame - nsPerFrame, 0.) / numTouches;
+
+		for (int t = 0; t < numTouches; ++t) {
+			sendTouchEvent(mEvents, ofTouchEventArgs::up, t, 0.f, 0.f);
+		}
+		ofxWidget::update();
+	}
+
+	// --- widget operations on random widgets
+
+	std::vector<size_t> targets(numOps);
+	for (auto & t : targets) {
+		t = anyWidget(mRng);
+	}
+
+	// a raise is timed together with the hit test that follows it, 
+	// so that any work it leaves for later is part of the result.
+	auto raiseAndHitTest = [&](size_t t_) {
+		mWidgets[t_]->bringToFront();
+		const auto & r = mWidgets[t_]->getRect();
+		sendMouseEvent(mEvents, ofMouseEventArgs::Moved, r.x + r.width * 0.5f, r.y + r.height * 0.5f);
+	};
+
+	result.nsPerOp["bringToFront"] = timeOps(numOps, [&]() {
+		for (auto t : targets)
+			raiseAndHitTest(t);
+	});
+
+	// raising leaves - widgets without children - is the worst case
+	// for bringToFront: every ancestor's range has to move, too. this
+	// is what clicking into a deeply nested widget costs.
+
+	std::vector<size_t> leaves;
+	{
+		std::vector<bool> hasChildren(numWidgets_, false);
+		for (auto p : mParents) {
+			if (p >= 0)
+				hasChildren[p] = true;
+		}
+		for (size_t i = 0; i < numWidgets_; ++i) {
+			if (!hasChildren[i])
+				leaves.push_back(i);
+		}
+	}
+
+	std::uniform_int_distribution<size_t> anyLeaf(0, leaves.size() - 1);
+	std::vector<size_t> leafTargets(numOps);
+	for (auto & t : leafTargets) {
+		t = leaves[anyLeaf(mRng)];
+	}
+
+	result.nsPerOp["raiseLeaf"] = timeOps(numOps, [&]() {
+		for (auto t : leafTargets)
+			raiseAndHitTest(t);
+	});
+
+	result.nsPerOp["moveBy"] = timeOps(numOps, [&]() {
+		for (auto t : targets)
+			mWidgets[t]->moveBy({ jitter(mRng), jitter(mRng) });
+	});
+
+	// dragging a small window around a big scene: every mouse move 
+	// moves the window, and gets hit-tested. only the window and its 
+	// few children have moved, so this should cost about as much as 
+	// moving a single widget, no matter how big the scene.
+
+	{
+		// parents come before their children, so we can add up 
+		// subtree sizes back to front.
+		std::vector<size_t> subtreeSize(numWidgets_, 1);
+		for (size_t i = numWidgets_; i-- > 0; ) {
+			if (mParents[i] >= 0)
+				subtreeSize[mParents[i]] += subtreeSize[i];
+		}
+		size_t window = 0;
+		for (size_t i = 0; i < numWidgets_; ++i) {
+			if (subtreeSize[i] > 1 && (subtreeSize[window] == 1 || subtreeSize[i] < subtreeSize[window]))
+				window = i;
+		}
+		mWidgets[window]->bringToFront(); // it was clicked, to start the drag
+
+		result.nsPerOp["dragWindow"] = timeOps(numOps, [&]() {
+			for (size_t i = 0; i < numOps; ++i) {
+				float step = (i & 1) ? -1.f : 1.f; // back and forth
+				mWidgets[window]->moveBy({ step, step });
+				const auto & r = mWidgets[window]->getRect();
+				sendMouseEvent(mEvents, ofMouseEventArgs::Moved, r.x + r.width * 0.5f, r.y + r.height * 0.5f);
+			}
+		});
+	}
+
+	mWidgets[anyWidget(mRng)]->setFocus(true);
+
+	result.nsPerOp["containsFocus"] = timeOps(numOps, [&]() {
+		for (auto t : targets)
+			sCallbackSink = sCallbackSink + uint64_t(mWidgets[t]->containsFocus());
+	});
+
+	// --- destroy: children first, as owners of nested widgets would.
+
+	result.nsPerOp["destroy"] = timeOps(numWidgets_, [&]() {
+		while (!mWidgets.empty())
+			mWidgets.pop_back();
+	});
+
+	// --- makeTree: the same scene again, built in one go.
+
+	result.nsPerOp["makeTree"] = timeOps(numWidgets_, [&]() {
+		mWidgets = ofxWidget::makeTree(mRects, mParents);
+	});
+
+	// --- destroyTree: parents first, which tears down whole subtrees.
+
+	result.nsPerOp["destroyTree"] = timeOps(numWidgets_, [&]() {
+		for (auto & w : mWidgets)
+			w.reset();
+	});
+
+	mWidgets.clear();
+
+	return result;
+}
+
+// ----------------------------------------------------------------------
+
+void WidgetBenchmark::print(const std::vector<Result>& results_, bool asCsv_) {
+
+	if (results_.empty())
+		return;
+
+	if (asCsv_) {
+		printf("operation");
+		for (const auto & r : results_)
+			printf(",%zu", r.numWidgets);
+		printf("\n");
+		for (const auto & name : getOperationNames()) {
+			printf("%s", name.c_str());
+			for (const auto & r : results_)
+				printf(",%.1f", r.nsPerOp.at(name));
+			printf("\n");
+		}
+		return;
+	}
+
+	// the scaling exponent k is estimated from the smallest and the
+	// largest scene, assuming cost per op grows with numWidgets^k:
+	// k ~ 0 means constant cost per operation, k ~ 1 means linear.
+
+	printf("ns/op           ");
+	for (const auto & r : results_)
+		printf("%12zu", r.numWidgets);
+	printf("   scaling\n");
+
+	for (const auto & name : getOperationNames()) {
+		printf("%-16s", name.c_str());
+		for (const auto & r : results_)
+			printf("%12.1f", r.nsPerOp.at(name));
+
+		const auto & lo = results_.front();
+		const auto & hi = results_.back();
+		if (hi.numWidgets > lo.numWidgets && lo.nsPerOp.at(name) > 0.) {
+			double k = std::log(hi.nsPerOp.at(name) / lo.nsPerOp.at(name)) / std::log(double(hi.numWidgets) / double(lo.numWidgets));
+			printf("   O(n^%.2f)", k);
+		}
+		printf("\n");
+	}
+}
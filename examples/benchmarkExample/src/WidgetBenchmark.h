@@ -0,0 +1,68 @@
+#pragma once
+
+#include "ofxWidget.h"
+#include "ofRectangle.h"
+
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+// Headless benchmark for the ofxWidget core.
+//
+// Generates synthetic widget scenes of increasing size, and measures
+// the cost of widget operations for each scene size, so that we get 
+// a scaling curve for each operation.
+//
+// No window or GL context is needed: draw and update callbacks don't 
+// draw anything, and mouse events are synthesised, and sent through 
+// the benchmark's own events, just as a window would send them. All
+// widgets live in the benchmark's own widget context.
+
+class WidgetBenchmark {
+public:
+
+	struct Settings {
+		size_t numWidgets   = 10000; // widget count for the largest scene
+		size_t numSteps     = 5;     // number of scene sizes: each step halves the widget count
+		size_t depth        = 4;     // maximum depth of widget trees, 0 means flat
+		size_t fanOut       = 8;     // number of children per widget
+		size_t numOps       = 2000;  // repetitions for each timed operation
+		size_t numFrames    = 100;   // repetitions for update and draw passes
+		float  gridCellSize = 0.f;   // if > 0, enables the hit test grid with this cell size
+		unsigned int seed   = 1;
+	};
+
+	struct Result {
+		size_t numWidgets = 0;
+		std::map<std::string, double> nsPerOp; // operation name -> nanoseconds per operation
+	};
+
+	WidgetBenchmark(const Settings& settings_);
+
+	std::vector<Result> run();
+
+	static const std::vector<std::string>& getOperationNames();
+	static void print(const std::vector<Result>& results_, bool asCsv_ = false);
+
+private:
+
+	Result runScene(size_t numWidgets_);
+
+	void generateScene(size_t numWidgets_);
+
+	Settings mSettings;
+	std::mt19937 mRng;
+
+	ofCoreEvents mEvents;	// stands in for a window's events
+	std::shared_ptr<ofxWidgetContext> mContext;
+
+	// scene description: for each widget, its rect, and the
+	// index of its parent widget, or -1 if it has no parent.
+	// parents always come before their children.
+	std::vector<ofRectangle> mRects;
+	std::vector<int> mParents;
+
+	std::vector<std::shared_ptr<ofxWidget>> mWidgets;
+};
@@ -0,0 +1,46 @@
+#include "ofMain.h"
+#include "WidgetBenchmark.h"
+
+#include <cstring>
+
+//========================================================================
+// headless: no window, no GL context - we only exercise the widget core.
+//
+// usage: benchmarkExample [--widgets N] [--steps N] [--depth N] [--fanout N] 
+//                         [--ops N] [--frames N] [--grid cellSize] [--seed N] [--csv]
+int main(int argc, char* argv[]) {
+
+	WidgetBenchmark::Settings settings;
+	bool asCsv = false;
+
+	for (int i = 1; i < argc; ++i) {
+		bool hasValue = (i + 1 < argc);
+		if (!strcmp(argv[i], "--csv")) {
+			asCsv = true;
+		} else if (hasValue && !strcmp(argv[i], "--widgets")) {
+			settings.numWidgets = strtoul(argv[++i], nullptr, 10);
+		} else if (hasValue && !strcmp(argv[i], "--steps")) {
+			settings.numSteps = strtoul(argv[++i], nullptr, 10);
+		} else if (hasValue && !strcmp(argv[i], "--depth")) {
+			settings.depth = strtoul(argv[++i], nullptr, 10);
+		} else if (hasValue && !strcmp(argv[i], "--fanout")) {
+			settings.fanOut = strtoul(argv[++i], nullptr, 10);
+		} else if (hasValue && !strcmp(argv[i], "--ops")) {
+			settings.numOps = strtoul(argv[++i], nullptr, 10);
+		} else if (hasValue && !strcmp(argv[i], "--frames")) {
+			settings.numFrames = strtoul(argv[++i], nullptr, 10);
+		} else if (hasValue && !strcmp(argv[i], "--grid")) {
+			settings.gridCellSize = float(atof(argv[++i]));
+		} else if (hasValue && !strcmp(argv[i], "--seed")) {
+			settings.seed = strtoul(argv[++i], nullptr, 10);
+		} else {
+			ofLogError() << "Unknown argument: " << argv[i];
+			return 1;
+		}
+	}
+
+	WidgetBenchmark benchmark(settings);
+	WidgetBenchmark::print(benchmark.run(), asCsv);
+
+	return 0;
+}
@@ -0,0 +1,120 @@
+#include "ofApp.h"
+#include "ofxWidget.h"
+
+//--------------------------------------------------------------
+void ofApp::setup() {
+	ofSetBackgroundColor(ofColor::darkGray);
+
+	// a list of 100k channels, every 10th row is a (taller) group header.
+	// only the rows in view get a widget.
+
+	mChannelNames.resize(100000);
+	for (size_t i = 0; i < mChannelNames.size(); ++i) {
+		mChannelNames[i] = (i % 10 == 0) ? "Group " + ofToString(i / 10) : "Channel " + ofToString(i);
+	}
+
+	mList = ofxWidgetList::make({ 20.f, 40.f, 300.f, 600.f });
+
+	mList->getWidget()->onDraw = [&w = mList->getWidget()]() {
+		ofSetColor(ofColor::lightGrey);
+		ofFill();
+		ofDrawRectangle(w->getRect());
+	};
+
+	mList->onRowHeight = [](size_t row_) {
+		return (row_ % 10 == 0) ? 40.f : 24.f;
+	};
+
+	mList->onBindRow = [this](size_t row_, std::shared_ptr<ofxWidget>& w_) {
+		// capture the widget weakly - the widget owns this callback.
+		w_->onDraw = [this, row_, weakWidget = std::weak_ptr<ofxWidget>(w_)]() {
+			auto w = weakWidget.lock();
+			if (!w)
+				return;
+			const auto & rect = w->getRect();
+			ofSetColor(w->getHover() ? ofColor(80) : ofColor(50));
+			ofFill();
+			ofDrawRectangle(rect.x + 1, rect.y + 1, rect.width - 2, rect.height - 2);
+			ofSetColor(ofColor::white);
+			ofDrawBitmapString(mChannelNames[row_], rect.x + 10, rect.y + rect.height - 8);
+		};
+	};
+
+	mList->setNumRows(mChannelNames.size());
+}
+
+//--------------------------------------------------------------
+void ofApp::update() {
+	ofxWidget::update();
+}
+
+//--------------------------------------------------------------
+void ofApp::draw() {
+	ofPushStyle();
+	ofxWidget::draw();
+	ofPopStyle();
+	ofSetColor(ofColor::white);
+	ofDrawBitmapString("Click the list, then use the mouse wheel to scroll.\n"
+		"Home/End jump to the top/bottom.\n"
+		"Row widgets: " + ofToString(mList->getNumRowWidgets()) + 
+		" for " + ofToString(mList->getNumRows()) + " rows", 340, 60);
+}
+
+//--------------------------------------------------------------
+void ofApp::keyPressed(int key) {
+	if (key == OF_KEY_HOME) {
+		mList->scrollToRow(0);
+	} else if (key == OF_KEY_END) {
+		mList->scrollToRow(mList->getNumRows() - 1);
+	}
+}
+
+//--------------------------------------------------------------
+void ofApp::keyReleased(int key) {
+
+}
+
+//--------------------------------------------------------------
+void ofApp::mouseMoved(int x, int y) {
+
+}
+
+//--------------------------------------------------------------
+void ofApp::mouseDragged(int x, int y, int button) {
+
+}
+
+//--------------------------------------------------------------
+void ofApp::mousePressed(int x, int y, int button) {
+
+}
+
+//--------------------------------------------------------------
+void ofApp::mouseReleased(int x, int y, int button) {
+
+}
+
+//--------------------------------------------------------------
+void ofApp::mouseEntered(int x, int y) {
+
+}
+
+//--------------------------------------------------------------
+void ofApp::mouseExited(int x, int y) {
+
+}
+
+//--------------------------------------------------------------
+void ofApp::windowResized(int w, int h) {
+
+}
+
+//--------------------------------------------------------------
+void ofApp::gotMessage(ofMessage msg) {
+
+}
+
+//--------------------------------------------------------------
+void ofApp::dragEvent(ofDragInfo dragInfo) {
+
+}
@@ -111,6 +111,8 @@ void Menu::mouseResponderMenuContainer(const ofMouseEventArgs& args_) {
 		return;
 	if (args_.type == ofMouseEventArgs::Pressed && args_.button == 0) {
 		mLastMouseDown = args_; // args_ is an ofVec2f, so we capture that slice for the position.
+		// keep receiving drags, even if the mouse outruns the menu.
+		mWiMenuContainer->capturePointer();
 	} else if (args_.type == ofMouseEventArgs::Dragged && args_.button == 0) {
 		// now we have to calculate the delta to the last 
 		// mouse pos, and signal that the rect needs to be recalculated.
@@ -1,7 +1,24 @@
 #include "ofxWidget.h"
+#include "ofxWidgetProfiler.h"
 #include "ofGraphics.h"
 #include "ofUtils.h"
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <new>
+#include <unordered_map>
+#include <utility>
+
+// hit-testing tests rects 8 (AVX) or 4 (SSE) at a time. define 
+// OFX_WIDGET_NO_SIMD to use the plain C++ version everywhere.
+#if !defined(OFX_WIDGET_NO_SIMD) && defined(__AVX__)
+#	include <immintrin.h>
+#	define OFX_WIDGET_AVX
+#elif !defined(OFX_WIDGET_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#	include <emmintrin.h>
+#	define OFX_WIDGET_SSE
+#endif
 // ----------------------------------------------------------------------
 /*
    _____    ___
@@ -32,474 +49,2853 @@ THE SOFTWARE.
 */
 // ----------------------------------------------------------------------
 
-// we want to keep track of all widgets that have been created.
-// this is a "flattened" version of our widget scene graph. 
-std::list<weak_ptr<ofxWidget>> sAllWidgets;
+// The widget registry holds one slot per widget, in contiguous storage.
+// Slots are addressed through ofxWidgetHandles (index + generation),
+// and released slots get recycled.
+//
+// Slots store raw pointers: a widget removes itself from the registry
+// when it is destroyed, so any pointer resolved through a valid handle
+// is safe to use - without having to lock() a weak_ptr first.
+//
+// The registry also keeps the "flattened" version of our widget scene 
+// graph (see README: sAllWidgets): a list in z-order, front to back,
+// which is threaded through the slots as prev/next slot indices. 
+// Each slot knows the frontmost element of its widget's range, and 
+// its parent slot, which means a widget can find itself, its 
+// subtree range, and its parent's range in O(1).
+
+class WidgetRegistry {
+
+public:
+
+	static const uint32_t npos = uint32_t(-1);
+
+	struct Slot {
+		ofxWidget* widget     = nullptr;
+		uint32_t   generation = 0;
+		uint32_t   prev       = npos; // z-order neighbour towards the front
+		uint32_t   next       = npos; // z-order neighbour towards the back
+		uint32_t   first      = npos; // frontmost element of this widget's range: itself, or its frontmost descendant
+		uint32_t   parent     = npos; // slot of parent widget
+		uint32_t   visibleIndex    = npos; // position in sVisibleWidgets, npos if not visible
+		uint32_t   visibleChildren = 0;    // number of descendants which are visible, provided this widget is visible
+		bool       containsFocus   = false; // whether this widget, or one of its descendants, has the focus
+	};
+
+private:
+
+	std::vector<Slot>     mSlots;
+	std::vector<uint32_t> mFreeSlots;
+
+	uint32_t mFront = npos; // frontmost widget
+	uint32_t mBack  = npos; // backmost widget
+
+public:
+
+	// allocates a slot for widget_, and links it to the front of the z-order list.
+	ofxWidgetHandle add(ofxWidget* widget_) {
+		auto h = allocate(widget_);
+		link(h.index, h.index, mFront);
+		return h;
+	}
+
+	// allocates a slot for widget_, without linking it into the z-order list.
+	ofxWidgetHandle allocate(ofxWidget* widget_) {
+		ofxWidgetHandle h;
+		if (mFreeSlots.empty()) {
+			h.index = uint32_t(mSlots.size());
+			mSlots.emplace_back();
+		} else {
+			h.index = mFreeSlots.back();
+			mFreeSlots.pop_back();
+		}
+		auto & slot = mSlots[h.index];
+		slot.widget = widget_;
+		slot.first  = h.index;
+		slot.parent = npos;
+		h.generation = slot.generation;
+		return h;
+	}
+
+	// releases a slot. the slot must have been unlinked before.
+	void remove(uint32_t i_) {
+		auto & slot = mSlots[i_];
+		slot.widget = nullptr;
+		slot.prev = slot.next = slot.first = slot.parent = slot.visibleIndex = npos;
+		slot.visibleChildren = 0;
+		slot.containsFocus = false;
+		++slot.generation; // invalidates all outstanding handles to this slot
+		mFreeSlots.push_back(i_);
+	}
+
+	ofxWidget* get(const ofxWidgetHandle& h_) const {
+		if (h_.index >= mSlots.size() || mSlots[h_.index].generation != h_.generation)
+			return nullptr;
+		return mSlots[h_.index].widget;
+	}
+
+	Slot& operator[](uint32_t i_) {
+		return mSlots[i_];
+	}
+
+	uint32_t front() const {
+		return mFront;
+	}
+
+	uint32_t back() const {
+		return mBack;
+	}
+
+	// removes the range [first_, last_] from the z-order list.
+	void unlink(uint32_t first_, uint32_t last_) {
+		auto prev = mSlots[first_].prev;
+		auto next = mSlots[last_].next;
+		(prev == npos ? mFront : mSlots[prev].next) = next;
+		(next == npos ? mBack : mSlots[next].prev) = prev;
+		mSlots[first_].prev = npos;
+		mSlots[last_].next = npos;
+	}
+
+	// links the range [first_, last_] into the z-order list, right 
+	// before pos_. if pos_ is npos, the range is appended at the back.
+	void link(uint32_t first_, uint32_t last_, uint32_t pos_) {
+		auto prev = (pos_ == npos ? mBack : mSlots[pos_].prev);
+		mSlots[first_].prev = prev;
+		mSlots[last_].next = pos_;
+		(prev == npos ? mFront : mSlots[prev].next) = first_;
+		(pos_ == npos ? mBack : mSlots[pos_].prev) = last_;
+	}
+};
+
+// ----------------------------------------------------------------------
+// The hit test grid is an (optional) spatial hash over widget rects.
+//
+// Every registered widget is binned into all grid cells its rect 
+// overlaps. The grid only knows about geometry: which of the widgets
+// in a cell is visible, and which one is topmost, we look up from the
+// widget's position in sVisibleWidgets. This means only changes in 
+// geometry (setRect, moveBy) need to update the grid, while changes 
+// in z-order and visibility don't touch it at all.
+
+class WidgetHitGrid {
+
+	static const int kMaxCellsPerWidget = 256; // larger widgets are kept in a separate list
+
+	struct Entry {
+		int32_t x0 = 0, y0 = 0, x1 = -1, y1 = -1; // range of cells this widget was binned into
+		bool    isBinned    = false;
+		bool    isOversized = false;
+	};
+
+	float mCellSize = 64.f;
+	std::unordered_map<uint64_t, std::vector<uint32_t>> mCells;
+	std::vector<uint32_t> mOversized; // widgets covering too many cells to be binned
+	std::vector<Entry>    mEntries;   // indexed by registry slot
+
+	static uint64_t key(int32_t x_, int32_t y_) {
+		return (uint64_t(uint32_t(x_)) << 32) | uint32_t(y_);
+	}
+
+	static void erase(std::vector<uint32_t>& v_, uint32_t slot_) {
+		auto it = std::find(v_.begin(), v_.end(), slot_);
+		if (it != v_.end()) {
+			*it = v_.back();
+			v_.pop_back();
+		}
+	}
+
+	int32_t cell(float v_) const {
+		return int32_t(std::floor(v_ / mCellSize));
+	}
+
+public:
+
+	bool bEnabled = false;
+
+	void clear(float cellSize_) {
+		mCellSize = std::max(cellSize_, 1.f);
+		mCells.clear();
+		mOversized.clear();
+		mEntries.clear();
+	}
+
+	void insert(uint32_t slot_, const ofRectangle& rect_) {
+		if (slot_ >= mEntries.size())
+			mEntries.resize(slot_ + 1);
+		auto & e = mEntries[slot_];
+
+		e.x0 = cell(rect_.getMinX());
+		e.y0 = cell(rect_.getMinY());
+		e.x1 = cell(rect_.getMaxX());
+		e.y1 = cell(rect_.getMaxY());
+		e.isBinned = true;
+		e.isOversized = (int64_t(e.x1 - e.x0 + 1) * int64_t(e.y1 - e.y0 + 1) > kMaxCellsPerWidget);
+
+		if (e.isOversized) {
+			mOversized.push_back(slot_);
+			return;
+		}
+		for (auto y = e.y0; y <= e.y1; ++y)
+			for (auto x = e.x0; x <= e.x1; ++x)
+				mCells[key(x, y)].push_back(slot_);
+	}
+
+	void remove(uint32_t slot_) {
+		if (slot_ >= mEntries.size() || !mEntries[slot_].isBinned)
+			return;
+		auto & e = mEntries[slot_];
+		if (e.isOversized) {
+			erase(mOversized, slot_);
+		} else {
+			for (auto y = e.y0; y <= e.y1; ++y)
+				for (auto x = e.x0; x <= e.x1; ++x) {
+					auto it = mCells.find(key(x, y));
+					if (it == mCells.end())
+						continue;
+					erase(it->second, slot_);
+					if (it->second.empty())
+						mCells.erase(it);
+				}
+		}
+		e = Entry();
+	}
+
+	void update(uint32_t slot_, const ofRectangle& rect_) {
+		if (slot_ < mEntries.size() && mEntries[slot_].isBinned && !mEntries[slot_].isOversized
+			&& cell(rect_.getMinX()) == mEntries[slot_].x0 && cell(rect_.getMaxX()) == mEntries[slot_].x1
+			&& cell(rect_.getMinY()) == mEntries[slot_].y0 && cell(rect_.getMaxY()) == mEntries[slot_].y1)
+			return; // still covers the same cells.
+		remove(slot_);
+		insert(slot_, rect_);
+	}
+
+	// the grid cell which contains x_,y_. widgets which aren't binned 
+	// into this cell don't overlap it.
+	void cellBounds(float x_, float y_, float& x0_, float& y0_, float& x1_, float& y1_) const {
+		x0_ = cell(x_) * mCellSize;
+		y0_ = cell(y_) * mCellSize;
+		x1_ = (cell(x_) + 1) * mCellSize;
+		y1_ = (cell(y_) + 1) * mCellSize;
+	}
+
+	// calls fn_ for every widget slot which might contain x_,y_
+	template<typename Fn>
+	void query(float x_, float y_, Fn fn_) const {
+		auto it = mCells.find(key(cell(x_), cell(y_)));
+		if (it != mCells.end())
+			for (auto s : it->second)
+				fn_(s);
+		for (auto s : mOversized)
+			fn_(s);
+	}
+};
+
+// ----------------------------------------------------------------------
+// same as std::rotate(v_.begin() + first_, v_.begin() + middle_, 
+// v_.begin() + last_) - but the smaller part goes through a buffer, 
+// so that the larger part moves in one go, which is a memmove for 
+// plain data. std::rotate on random access iterators swaps elements
+// around in cycles, which is much slower for long ranges.
+
+template<typename T>
+void rotateRange(std::vector<T>& v_, size_t first_, size_t middle_, size_t last_) {
+	static thread_local std::vector<T> buffer;
+	auto p = v_.data();
+	if (middle_ - first_ <= last_ - middle_) {
+		buffer.assign(p + first_, p + middle_);
+		std::copy(p + middle_, p + last_, p + first_);
+		std::copy(buffer.begin(), buffer.end(), p + first_ + (last_ - middle_));
+	} else {
+		buffer.assign(p + middle_, p + last_);
+		std::copy_backward(p + first_, p + middle_, p + last_);
+		std::copy(buffer.begin(), buffer.end(), p + first_);
+	}
+}
+
+// replaces the elements of v_ starting at first_ with the ranges 
+// pieces_, in order. the pieces must be a re-arrangement of exactly 
+// the elements they replace.
+template<typename T>
+void gatherRanges(std::vector<T>& v_, size_t first_, const std::vector<std::pair<size_t, size_t>>& pieces_) {
+	static thread_local std::vector<T> buffer;
+	buffer.clear();
+	for (const auto & r : pieces_)
+		buffer.insert(buffer.end(), v_.begin() + r.first, v_.begin() + r.second);
+	std::copy(buffer.begin(), buffer.end(), v_.begin() + first_);
+}
+
+// ----------------------------------------------------------------------
+// Bounds of all visible widgets, as a structure of arrays: min and 
+// max coordinates each get their own array, in the order of 
+// mVisibleWidgets, back to front. This lets us test a point against 
+// a whole block of rects in a handful of SIMD instructions.
+//
+// The arrays are padded to a whole number of blocks with rects which 
+// contain nothing. They are rebuilt lazily, once the list of visible 
+// widgets has changed - widgets which move just update their entries.
+
+class WidgetHitBounds {
+
+public:
+
+#if defined(OFX_WIDGET_AVX)
+	static const size_t kBlockSize = 8;
+#else
+	static const size_t kBlockSize = 4;
+#endif
+
+private:
+
+	std::vector<float> mX0, mY0, mX1, mY1;
+	size_t mSize = 0;
+
+public:
+
+	uint64_t mVisibleWidgetsVersion = uint64_t(-1); // version of the visible list the bounds were built from
+
+	size_t size() const {
+		return mSize;
+	}
+
+	void resize(size_t size_) {
+		// rects which contain nothing: no point lies right of +inf. 
+		auto padded = (size_ + kBlockSize - 1) / kBlockSize * kBlockSize;
+		mSize = size_;
+		mX0.assign(padded, std::numeric_limits<float>::infinity());
+		mY0.assign(padded, std::numeric_limits<float>::infinity());
+		mX1.assign(padded, -std::numeric_limits<float>::infinity());
+		mY1.assign(padded, -std::numeric_limits<float>::infinity());
+	}
+
+	// moves entries [middle_, last_) to first_, just like std::rotate
+	void rotate(size_t first_, size_t middle_, size_t last_) {
+		for (auto v : { &mX0, &mY0, &mX1, &mY1 })
+			rotateRange(*v, first_, middle_, last_);
+	}
+
+	// re-arranges entries starting at first_, just like gatherRanges
+	void gather(size_t first_, const std::vector<std::pair<size_t, size_t>>& pieces_) {
+		for (auto v : { &mX0, &mY0, &mX1, &mY1 })
+			gatherRanges(*v, first_, pieces_);
+	}
+
+	float minX(size_t i_) const { return mX0[i_]; }
+	float minY(size_t i_) const { return mY0[i_]; }
+	float maxX(size_t i_) const { return mX1[i_]; }
+	float maxY(size_t i_) const { return mY1[i_]; }
+
+	void set(size_t i_, const ofRectangle& rect_) {
+		mX0[i_] = rect_.getMinX();
+		mY0[i_] = rect_.getMinY();
+		mX1[i_] = rect_.getMaxX();
+		mY1[i_] = rect_.getMaxY();
+	}
+
+	// returns a bit mask of the rects in the block starting at i_ which
+	// contain x_, y_ - bit n is set if rect i_ + n contains the point. 
+	// same as ofRectangle::inside(): points on the edge are outside.
+	unsigned int insideMask(size_t i_, float x_, float y_) const {
+#if defined(OFX_WIDGET_AVX)
+		auto px = _mm256_set1_ps(x_);
+		auto py = _mm256_set1_ps(y_);
+		auto m = _mm256_and_ps(
+			_mm256_and_ps(_mm256_cmp_ps(px, _mm256_loadu_ps(&mX0[i_]), _CMP_GT_OQ), _mm256_cmp_ps(py, _mm256_loadu_ps(&mY0[i_]), _CMP_GT_OQ)),
+			_mm256_and_ps(_mm256_cmp_ps(px, _mm256_loadu_ps(&mX1[i_]), _CMP_LT_OQ), _mm256_cmp_ps(py, _mm256_loadu_ps(&mY1[i_]), _CMP_LT_OQ)));
+		return unsigned(_mm256_movemask_ps(m));
+#elif defined(OFX_WIDGET_SSE)
+		auto px = _mm_set1_ps(x_);
+		auto py = _mm_set1_ps(y_);
+		auto m = _mm_and_ps(
+			_mm_and_ps(_mm_cmpgt_ps(px, _mm_loadu_ps(&mX0[i_])), _mm_cmpgt_ps(py, _mm_loadu_ps(&mY0[i_]))),
+			_mm_and_ps(_mm_cmplt_ps(px, _mm_loadu_ps(&mX1[i_])), _mm_cmplt_ps(py, _mm_loadu_ps(&mY1[i_]))));
+		return unsigned(_mm_movemask_ps(m));
+#else
+		unsigned int mask = 0;
+		for (size_t n = 0; n < kBlockSize; ++n) {
+			bool isInside = x_ > mX0[i_ + n] && y_ > mY0[i_ + n] && x_ < mX1[i_ + n] && y_ < mY1[i_ + n];
+			mask |= unsigned(isInside) << n;
+		}
+		return mask;
+#endif
+	}
+
+	// returns a bit mask of the rects in the block starting at i_ which
+	// overlap the open rect x0_, y0_, x1_, y1_, in the same way.
+	unsigned int overlapMask(size_t i_, float x0_, float y0_, float x1_, float y1_) const {
+#if defined(OFX_WIDGET_AVX)
+		auto m = _mm256_and_ps(
+			_mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(&mX0[i_]), _mm256_set1_ps(x1_), _CMP_LT_OQ), _mm256_cmp_ps(_mm256_loadu_ps(&mY0[i_]), _mm256_set1_ps(y1_), _CMP_LT_OQ)),
+			_mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(&mX1[i_]), _mm256_set1_ps(x0_), _CMP_GT_OQ), _mm256_cmp_ps(_mm256_loadu_ps(&mY1[i_]), _mm256_set1_ps(y0_), _CMP_GT_OQ)));
+		return unsigned(_mm256_movemask_ps(m));
+#elif defined(OFX_WIDGET_SSE)
+		auto m = _mm_and_ps(
+			_mm_and_ps(_mm_cmplt_ps(_mm_loadu_ps(&mX0[i_]), _mm_set1_ps(x1_)), _mm_cmplt_ps(_mm_loadu_ps(&mY0[i_]), _mm_set1_ps(y1_))),
+			_mm_and_ps(_mm_cmpgt_ps(_mm_loadu_ps(&mX1[i_]), _mm_set1_ps(x0_)), _mm_cmpgt_ps(_mm_loadu_ps(&mY1[i_]), _mm_set1_ps(y0_))));
+		return unsigned(_mm_movemask_ps(m));
+#else
+		unsigned int mask = 0;
+		for (size_t n = 0; n < kBlockSize; ++n) {
+			bool overlaps = mX0[i_ + n] < x1_ && mY0[i_ + n] < y1_ && mX1[i_ + n] > x0_ && mY1[i_ + n] > y0_;
+			mask |= unsigned(overlaps) << n;
+		}
+		return mask;
+#endif
+	}
+};
+
+// ----------------------------------------------------------------------
+// The result of the last single-point hit test, together with a safe 
+// rect around the point that was tested: the hit widget's rect, minus
+// its clipped parts, and minus the rects of all visible widgets in 
+// front of it. As long as nothing has changed, any point inside the 
+// safe rect hits the same widget - which is what most mouse moves 
+// are: small jitters within the widget under the mouse. If nothing 
+// was hit, the safe rect keeps clear of all visible widgets.
+
+struct WidgetHitCache {
+	ofxWidgetHandle hit;
+	float           x0 = 0.f, y0 = 0.f, x1 = 0.f, y1 = 0.f; // safe rect - as min and max, which an ofRectangle might round
+	uint64_t        visibleWidgetsVersion = uint64_t(-1);
+	uint64_t        geometryVersion       = uint64_t(-1);
+
+	bool isInside(float x_, float y_) const {
+		return x_ > x0 && y_ > y0 && x_ < x1 && y_ < y1;
+	}
+};
+
+// ----------------------------------------------------------------------
+// Every touch which is down keeps its own state, just like the mouse
+// does: the widget the touch went down on gets all of the touch's 
+// events, while the widget under the touch is tracked for hover - 
+// unless the touch has been captured.
+
+struct WidgetTouch {
+	int             id;
+	ofxWidgetHandle target;		// widget which receives this touch's events
+	ofxWidgetHandle over;		// widget under the touch
+	bool            bCaptured;	// if captured, moves skip the hit test, and over stays put
+	WidgetHitCache  hitCache;	// where over holds - most moves are small
+};
+
+// ----------------------------------------------------------------------
+// with input batching enabled, input events are queued, and 
+// dispatched from within update(). a mouse move (or drag) replaces 
+// a mouse move (or drag) right before it in the queue, all other 
+// events keep their order.
+
+struct QueuedInputEvent {
+	bool isMouseEvent;
+	ofMouseEventArgs mouse;
+	ofKeyEventArgs key;
+};
+
+// ----------------------------------------------------------------------
+// Input events posted from other threads go through a bounded, 
+// lock-free queue: any number of threads may push, while only the
+// thread which updates the widget context pops, from within update().
+//
+// This is Dmitry Vyukov's bounded MPMC queue: each cell carries a 
+// sequence number, which tells producers and the consumer whether 
+// the cell is free, or holds an event for them to take. A producer 
+// claims a cell by advancing the enqueue position with a CAS, and 
+// publishes the event by bumping the cell's sequence number.
+
+class PostedInputQueue {
+
+	static const size_t kCapacity = 1024; // must be a power of two. every context has its own queue.
+
+	struct Cell {
+		std::atomic<size_t> sequence;
+		QueuedInputEvent    event;
+	};
+
+	std::unique_ptr<Cell[]> mCells;
+	std::atomic<size_t>     mEnqueuePos;
+	size_t                  mDequeuePos = 0; // only ever touched by the consumer
+
+public:
+
+	PostedInputQueue()
+		: mCells(new Cell[kCapacity])
+		, mEnqueuePos(0) {
+		for (size_t i = 0; i < kCapacity; ++i)
+			mCells[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	// may be called from any thread. returns false if the queue is full.
+	bool push(const QueuedInputEvent& event_) {
+		auto pos = mEnqueuePos.load(std::memory_order_relaxed);
+		for (;;) {
+			auto & cell = mCells[pos & (kCapacity - 1)];
+			auto seq = cell.sequence.load(std::memory_order_acquire);
+			auto dif = intptr_t(seq) - intptr_t(pos);
+			if (dif == 0) {
+				if (mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					cell.event = event_;
+					cell.sequence.store(pos + 1, std::memory_order_release);
+					return true;
+				}
+			} else if (dif < 0) {
+				return false; // full
+			} else {
+				pos = mEnqueuePos.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	// consumer thread only. returns false if the queue is empty.
+	bool pop(QueuedInputEvent& event_) {
+		auto & cell = mCells[mDequeuePos & (kCapacity - 1)];
+		if (cell.sequence.load(std::memory_order_acquire) != mDequeuePos + 1)
+			return false;
+		event_ = cell.event;
+		cell.sequence.store(mDequeuePos + kCapacity, std::memory_order_release);
+		++mDequeuePos;
+		return true;
+	}
+};
+
+// ----------------------------------------------------------------------
+// Widgets, and the control blocks of their shared_ptrs, are allocated 
+// from per-context pools: fixed-size blocks, carved out of chunks of 
+// many blocks each. This keeps the widgets of one UI next to each 
+// other in memory, and means that UIs which make and destroy lots 
+// of widgets don't fragment the heap. 
+//
+// Freed blocks go onto a free list, and are re-used last in, first 
+// out, while they are still warm in the cache. Chunks are only freed 
+// with the pool.
+//
+// A pool belongs to its context's thread - except that blocks may be
+// given back from any thread with deallocateConcurrent(). These go 
+// onto a lock-free list of their own, which allocate() takes over 
+// in one go once the free list runs dry.
+
+class WidgetPool {
+
+	static const size_t kBlocksPerChunk = 256;
+
+	std::vector<std::unique_ptr<char[]>> mChunks;
+	size_t mBlockSize = 0;				 // set by the first allocation
+	size_t mNumBlocksUsed = kBlocksPerChunk; // blocks handed out from the last chunk
+	void*  mFreeList = nullptr;			 // freed blocks, each block holds a pointer to the next
+	std::atomic<void*> mConcurrentFreeList{ nullptr }; // blocks freed by deallocateConcurrent(), linked the same way
+
+public:
+
+	// whether a block can hold size_ bytes. the first call decides 
+	// the block size.
+	bool fits(size_t size_) {
+		if (mBlockSize == 0) {
+			auto align = alignof(std::max_align_t);
+			mBlockSize = (std::max(size_, sizeof(void*)) + align - 1) / align * align;
+		}
+		return size_ <= mBlockSize;
+	}
+
+	void* allocate() {
+		if (!mFreeList && mConcurrentFreeList.load(std::memory_order_relaxed))
+			mFreeList = mConcurrentFreeList.exchange(nullptr, std::memory_order_acquire);
+		if (mFreeList) {
+			auto p = mFreeList;
+			mFreeList = *static_cast<void**>(p);
+			return p;
+		}
+		if (mNumBlocksUsed == kBlocksPerChunk) {
+			// operator new[] aligns for any fundamental type, and so 
+			// does our block size.
+			mChunks.emplace_back(new char[mBlockSize * kBlocksPerChunk]);
+			mNumBlocksUsed = 0;
+		}
+		return mChunks.back().get() + mBlockSize * mNumBlocksUsed++;
+	}
+
+	void deallocate(void* p_) {
+		*static_cast<void**>(p_) = mFreeList;
+		mFreeList = p_;
+	}
+
+	// thread-safe: blocks are only ever pushed here, and allocate() 
+	// takes the whole list at once, so a compare-and-swap suffices.
+	void deallocateConcurrent(void* p_) {
+		auto head = mConcurrentFreeList.load(std::memory_order_relaxed);
+		do {
+			*static_cast<void**>(p_) = head;
+		} while (!mConcurrentFreeList.compare_exchange_weak(head, p_, std::memory_order_release, std::memory_order_relaxed));
+	}
+};
+
+// ----------------------------------------------------------------------
+// allocator for shared_ptr control blocks. control blocks live as long
+// as any weak_ptr to their widget, which may well be longer than the
+// widget's context - so the allocator keeps its pool alive. the last
+// weak_ptr may also be let go of on any thread, say, by a thread which
+// posts input events - so control blocks are freed concurrently.
+
+template<typename T>
+struct WidgetPoolAllocator {
+
+	typedef T value_type;
+
+	std::shared_ptr<WidgetPool> pool;
+
+	WidgetPoolAllocator(const std::shared_ptr<WidgetPool>& pool_)
+		: pool(pool_) {
+	}
+
+	template<typename U>
+	WidgetPoolAllocator(const WidgetPoolAllocator<U>& other_)
+		: pool(other_.pool) {
+	}
+
+	T* allocate(size_t n_) {
+		if (n_ != 1 || !pool->fits(sizeof(T)))
+			return static_cast<T*>(::operator new(n_ * sizeof(T)));
+		return static_cast<T*>(pool->allocate());
+	}
+
+	void deallocate(T* p_, size_t n_) {
+		if (n_ != 1 || !pool->fits(sizeof(T))) {
+			::operator delete(p_);
+		} else {
+			pool->deallocateConcurrent(p_);
+		}
+	}
+
+	template<typename U>
+	bool operator==(const WidgetPoolAllocator<U>& rhs_) const {
+		return pool == rhs_.pool;
+	}
+
+	template<typename U>
+	bool operator!=(const WidgetPoolAllocator<U>& rhs_) const {
+		return pool != rhs_.pool;
+	}
+};
+
+// ----------------------------------------------------------------------
+// A widget context holds everything which used to be global: the
+// registry, the visible widget list and frame snapshot, focus, input
+// queues and settings. 
+//
+// Everything inside is plain data - contexts are only ever touched 
+// from within this file, and by one thread at a time.
+
+class WidgetContext : public ofxWidgetContext {
+
+public:
+
+	WidgetRegistry mRegistry;
+
+	WidgetHitGrid mHitGrid;
+
+	// widgets with children which have moved since rects were last 
+	// updated. moving a widget only moves its local rect, so the rects 
+	// of its subtree - and their place in the grid and hit bounds - 
+	// are updated lazily, next time anybody asks for a rect.
+	std::vector<ofxWidgetHandle> mRectsPending;
+
+	// bounds of all visible widgets, for hit-testing without the grid.
+	WidgetHitBounds mHitBounds;
+
+	// incremented whenever any widget rect, or clipping changes.
+	uint64_t mGeometryVersion = 0;
+	WidgetHitCache mHitCache;
+
+	// a list of visible widgets - these are the widgets which are visible
+	// and whose ancestors are all visible, too. 
+	//
+	// Note that this list is kept back to front, that is, in draw order: 
+	// a widget comes first, followed by its visible children, and its 
+	// visible range spans [visibleIndex, visibleIndex + visibleChildren].
+	//
+	// The list is kept up to date incrementally: whenever widgets are 
+	// created, destroyed, parented, raised, or change visibility, the 
+	// visible range of the affected widget is spliced in, out, or rotated.
+	//
+	// Destroyed widgets are not erased right away, but leave tombstones
+	// (invalid handles), so that tearing down many widgets in a row does 
+	// not shift the list once per widget. While there are tombstones, the 
+	// visible child counts of widgets in the list still include them. 
+	// Tombstones get compacted in one go, before the list is next used.
+	std::vector<ofxWidgetHandle> mVisibleWidgets;
+	uint64_t mVisibleWidgetsVersion = 0; // incremented whenever mVisibleWidgets, or the visible ranges in it change
+	size_t mNumVisibleTombstones = 0;    // number of invalid handles in mVisibleWidgets
+
+	// The frame snapshot is a dense array of pointers to all visible 
+	// widgets, back to front, which draw() and update() iterate over.
+	// It gets rebuilt only if mVisibleWidgets has changed since, and 
+	// stays valid for the duration of a pass: widgets released while a 
+	// pass is running are unregistered immediately, but their memory is 
+	// only freed once the pass is over.
+	std::vector<ofxWidget*> mFrameWidgets;
+	uint64_t mFrameWidgetsVersion = uint64_t(-1);
+	int mPassDepth = 0;
+	std::vector<ofxWidget*> mDeferredReleases; // widgets released during a pass
+
+	std::vector<uint32_t> mFrameRangeEnds; // per frame snapshot entry: index right after its visible range
+
+	// draw culling is opt-in: if enabled, draw() first walks the frame 
+	// snapshot front to back, and marks widgets which can't be seen.
+	bool bDrawCulling = false;
+	std::vector<uint8_t> mFrameCulled; // per frame snapshot entry: 1 if culled
+
+	// if any widgets clip their children, draw() marks widgets which are 
+	// fully clipped, and keeps the unclipped part of each widget's rect.
+	size_t mNumClippingWidgets = 0;
+	std::vector<ofRectangle> mFrameClippedRects; // per frame snapshot entry
+
+	// the widget that is in focus and will receive interactions. the
+	// focused widget and its ancestors are marked in their registry 
+	// slots, so that asking whether a widget contains the focus is a 
+	// lookup. only ever set this through setFocusedWidget().
+	ofxWidgetHandle mFocusedWidget;
+	ofxWidgetHandle mWidgetUnderMouse;
+	ofVec2f         mLastMousePos{ 0.f, 0.f };
+
+	// while a widget holds the pointer capture, mouse events go 
+	// straight to it. the capture ends with the next mouse release, 
+	// or silently, once the handle goes stale.
+	ofxWidgetHandle mCapturedWidget;
+
+	// touches which are down, and touch events waiting to be dispatched.
+	// touch events are always queued, so that all touches of a frame 
+	// can be hit-tested in one go, from within update().
+	std::vector<WidgetTouch> mTouches;
+	std::vector<ofTouchEventArgs> mTouchQueue;
+	int mDispatchingTouch = -1;	// id of the touch whose event is being dispatched, -1 if none
+
+	bool bInputBatching = false;
+	std::vector<QueuedInputEvent> mInputQueue;
+
+	PostedInputQueue mPostedInput;
+	size_t mMaxPostedEventsPerFrame = 256;
+
+	WidgetPool mWidgetPool;
+	std::shared_ptr<WidgetPool> mControlBlockPool = std::make_shared<WidgetPool>();
+
+	std::unique_ptr<WidgetEventResponder> mResponder;
+	bool bListenToAppEvents = false; // start listening to ofEvents() once the first widget is made
+
+	~WidgetContext();
+
+	static WidgetContext& current();
+
+	void initEventResponder();
+
+	std::shared_ptr<ofxWidget> newWidget();	// allocate a widget in this context - not registered yet
+	void deleteWidget(ofxWidget* w_);		// destroy a widget, and free its memory
+
+	bool isSame(const ofxWidgetHandle &lhs, const ofxWidgetHandle &rhs);
+	template<typename Fn>
+	void forEachChild(uint32_t element_, Fn fn_);
+	void updateRects();
+	void updateHitBounds();
+	void updateHitBoundsOf(uint32_t element_);
+	void setFocusedWidget(const ofxWidgetHandle& handle_);
+	void markFocusPath(uint32_t element_, bool containsFocus_);
+	void moveRangeToFrontOf(uint32_t element_, uint32_t parent_);
+
+	void reindexVisible(size_t from_, size_t to_);
+	void compactVisible();
+	void tombstoneVisibleRange(uint32_t element_);
+	void eraseVisibleRange(uint32_t element_);
+	void insertVisibleRange(uint32_t element_, size_t pos_);
+	void moveVisibleRange(uint32_t element_, size_t pos_);
+	void raiseVisibleRanges(uint32_t element_);
+	size_t visibleEndOf(uint32_t element_);
+	size_t visibleInsertPosition(uint32_t element_);
+	void addVisibleChildren(uint32_t parent_, int64_t delta_);
+
+	bool isClippedAt(uint32_t element_, float x_, float y_);
+	void clipFrameWidgets();
+	void cullFrameWidgets(const ofRectangle& viewport_, bool useClippedRects_);
+
+	std::shared_ptr<ofxWidget> fromHandle(const ofxWidgetHandle& handle_);
+	ofxWidgetHandle hitTest(float x_, float y_); // return topmost visible widget under x_, y_
+	void hitTest(const ofVec2f* points_, size_t numPoints_, ofxWidgetHandle* hits_); // hit-test many points in one go
+	bool isCached(const WidgetHitCache& cache_, float x_, float y_) const; // whether cache_ holds the hit for x_, y_
+	void updateHitCache(WidgetHitCache& cache_, float x_, float y_, const ofxWidgetHandle& hit_);
+	void bringToFront(const ofxWidgetHandle& handle_);
+
+	void update();
+	void draw();
+
+	bool mouseEvent(ofMouseEventArgs& args);
+	void updateHover(const ofxWidgetHandle& underMouse_);
+	void press(const ofxWidgetHandle& pressed_); // focus and raise a pressed widget - or drop the focus, if nothing was pressed
+	void queueTouchEvent(const ofTouchEventArgs& args_);
+	void dispatchTouchQueue();	// dispatch all queued touch events
+	void dispatchTouchEvent(ofTouchEventArgs& args_, const ofxWidgetHandle& hit_);
+	WidgetTouch* findTouch(int id_);
+	void updateTouchOver(WidgetTouch& touch_, const ofxWidgetHandle& over_);
+	bool keyEvent(ofKeyEventArgs& args);
+	void dispatchInputQueue();	// dispatch all batched input events
+	void dispatchPostedInput();	// dispatch input events posted from other threads
+};
+
+// ----------------------------------------------------------------------
+
+thread_local ofxWidgetContext* tCurrentContext = nullptr; // nullptr means the default context
+
+// ----------------------------------------------------------------------
+
+WidgetContext& WidgetContext::current() {
+	return static_cast<WidgetContext&>(ofxWidgetContext::getCurrent());
+}
+
+// ----------------------------------------------------------------------
+
+inline WidgetContext& ofxWidget::context() const {
+	return static_cast<WidgetContext&>(*mContext);
+}
+
+// ----------------------------------------------------------------------
+
+bool WidgetContext::isSame(const ofxWidgetHandle &lhs, const ofxWidgetHandle &rhs) {
+	return (lhs == rhs && mRegistry.get(lhs) != nullptr);
+}
+
+// ----------------------------------------------------------------------
+
+template<typename Fn>
+void WidgetContext::forEachChild(uint32_t element_, Fn fn_) {
+	// calls fn_ for every direct child of element_, back to front.
+	// the element right before a widget is its backmost child, and 
+	// the element right before a child's range is its next sibling.
+	auto end = mRegistry[mRegistry[element_].first].prev;
+	for (auto i = mRegistry[element_].prev; i != end; i = mRegistry[mRegistry[i].first].prev) {
+		fn_(i);
+	}
+}
+
+// ----------------------------------------------------------------------
+
+void WidgetContext::updateRects() {
+	// re-calculate rects for all subtrees which have moved since the 
+	// last update - and nobody else. hit bounds and grid get patched
+	// as we go. (subtrees may be nested, in which case the inner one
+	// is simply done twice.)
+	bRectsPending = false;
+	bool isHitBoundsCurrent = (mHitBounds.mVisibleWidgetsVersion == mVisibleWidgetsVersion);
+	for (const auto & h : mRectsPending) {
+		if (mRegistry.get(h) == nullptr)
+			continue;
+		// walking a range from its end backwards, we meet every widget 
+		// before its children.
+		auto first = mRegistry[h.index].first;
+		for (auto i = h.index; ; i = mRegistry[i].prev) {
+			auto & slot = mRegistry[i];
+			auto w = slot.widget;
+			w->mRect = w->mLocalRect;
+			if (slot.parent != WidgetRegistry::npos)
+				w->mRect.position += mRegistry[slot.parent].widget->mRect.position;
+			if (mHitGrid.bEnabled)
+				mHitGrid.update(i, w->mRect);
+			if (isHitBoundsCurrent && slot.visibleIndex != WidgetRegistry::npos && slot.visibleIndex < mHitBounds.size())
+				mHitBounds.set(slot.visibleIndex, w->mRect);
+			if (i == first)
+				break;
+		}
+	}
+	mRectsPending.clear();
+}
+
+// ----------------------------------------------------------------------
+
+void WidgetContext::setFocusedWidget(const ofxWidgetHandle& handle_) {
+	// move the focus path over from the previously focused widget 
+	// (if it is still around) to the new one. O(depth), twice.
+	if (mRegistry.get(mFocusedWidget))
+		markFocusPath(mFocusedWidget.index, false);
+	mFocusedWidget = handle_;
+	if (mRegistry.get(mFocusedWidget))
+		markFocusPath(mFocusedWidget.index, true);
+}
+
+// ----------------------------------------------------------------------
+
+void WidgetContext::markFocusPath(uint32_t element_, bool containsFocus_) {
+	// mark (or unmark) element_ and all its ancestors as containing the focus.
+	for (auto a = element_; a != WidgetRegistry::npos; a = mRegistry[a].parent) {
+		mRegistry[a].containsFocus = containsFocus_;
+	}
+}
+
+// ----------------------------------------------------------------------
+
+void WidgetContext::updateHitBounds() {
+	// rebuild bounds for all visible widgets, if the visible list has 
+	// changed since we last built them. widgets which moved since have 
+	// their bounds patched by updateRects().
+	compactVisible();
+	updateRects();
+	if (mHitBounds.mVisibleWidgetsVersion == mVisibleWidgetsVersion)
+		return;
+	mHitBounds.resize(mVisibleWidgets.size());
+	for (size_t i = 0; i < mVisibleWidgets.size(); ++i) {
+		mHitBounds.set(i, mRegistry[mVisibleWidgets[i].index].widget->getRect());
+	}
+	mHitBounds.mVisibleWidgetsVersion = mVisibleWidgetsVersion;
+}
+
+// ----------------------------------------------------------------------
+
+void WidgetContext::updateHitBoundsOf(uint32_t element_) {
+	// a single widget has moved, without moving anybody else: if the 
+	// bounds are up to date otherwise, patch them, instead of having 
+	// them rebuilt. 
+	if (mHitBounds.mVisibleWidgetsVersion != mVisibleWidgetsVersion)
+		return; // will be rebuilt anyway.
+	auto i = mRegistry[element_].visibleIndex;
+	if (i != WidgetRegistry::npos && i < mHitBounds.size())
+		mHitBounds.set(i, mRegistry[element_].widget->getRect());
+}
+
+// ----------------------------------------------------------------------
+
+template<typename Callback, typename ... Args>
+bool notify(const shared_ptr<ofxWidget>& w_, ofxWidgetProfiler::Callback which_, Callback& callback_, Args& ... args_) {
+	// call a widget's callback, if it has one - and let the profiler know.
+	// returns whether there was a callback to call.
+	if (!callback_)
+		return false;
+	ofxWidgetProfiler::Scope profile(w_->getContext(), w_->getHandle(), which_);
+	callback_(args_...);
+	return true;
+}
+
+// ----------------------------------------------------------------------
+
+void WidgetContext::moveRangeToFrontOf(uint32_t element_, uint32_t parent_) {
+	// move the range of element_ to the front of the range of parent_, 
+	// within its current list, and update the range starts of 
+	// parent_ and of any ancestors that shared parent_'s range start.
+	// if parent_ is npos, the range is moved to the front of the list.
+
+	auto first = mRegistry[element_].first;
+	auto pos = (parent_ == WidgetRegistry::npos ? mRegistry.front() : mRegistry[parent_].first);
+
+	if (first == pos)
+		return; // already at the front.
+
+	mRegistry.unlink(first, element_);
+	mRegistry.link(first, element_, pos);
+
+	for (auto a = parent_; a != WidgetRegistry::npos && mRegistry[a].first == pos; a = mRegistry[a].parent) {
+		mRegistry[a].first = first;
+	}
+}
+
+// ----------------------------------------------------------------------
+
+void WidgetContext::reindexVisible(size_t from_, size_t to_) {
+	// update visible indices after elements [from_, to_) of 
+	// mVisibleWidgets have moved.
+	for (auto i = from_; i < to_; ++i) {
+		mRegistry[mVisibleWidgets[i].index].visibleIndex = uint32_t(i);
+	}
+	++mVisibleWidgetsVersion;
+}
+
+// ----------------------------------------------------------------------
+
+void WidgetContext::compactVisible() {
+	// remove all tombstones from mVisibleWidgets, and subtract 
+	// tombstones from the visible child counts of the widgets whose 
+	// ranges contained them.
+	if (mNumVisibleTombstones == 0)
+		return;
+	static thread_local std::vector<uint32_t> tombstonesBefore;
+	auto n = mVisibleWidgets.size();
+	tombstonesBefore.resize(n + 1);
+	tombstonesBefore[0] = 0;
+	for (size_t i = 0; i < n; ++i) {
+		tombstonesBefore[i + 1] = tombstonesBefore[i] + (mVisibleWidgets[i].isValid() ? 0 : 1);
+	}
+	for (size_t i = 0; i < n; ++i) {
+		if (!mVisibleWidgets[i].isValid())
+			continue;
+		auto & slot = mRegistry[mVisibleWidgets[i].index];
+		slot.visibleChildren -= tombstonesBefore[i + 1 + slot.visibleChildren] - tombstonesBefore[i + 1];
+	}
+	mVisibleWidgets.erase(std::remove_if(mVisibleWidgets.begin(), mVisibleWidgets.end(), [](const ofxWidgetHandle& h) {
+		return !h.isValid();
+	}), mVisibleWidgets.end());
+	mNumVisibleTombstones = 0;
+	reindexVisible(0, mVisibleWidgets.size());
+}
+
+// ----------------------------------------------------------------------
+
+void WidgetContext::tombstoneVisibleRange(uint32_t element_) {
+	// replace element_ and its visible children with tombstones.
+	// element_ must be visible.
+	auto first = mRegistry[element_].visibleIndex;
+	auto last = first + 1 + mRegistry[element_].visibleChildren;
+	for (auto i = first; i != last; ++i) {
+		auto & h = mVisibleWidgets[i];
+		if (!h.isValid())
+			continue;
+		mRegistry[h.index].visibleIndex = WidgetRegistry::npos;
+		h = ofxWidgetHandle();
+		++mNumVisibleTombstones;
+	}
+	++mVisibleWidgetsVersion;
+}
+
+// ----------------------------------------------------------------------
+
+void WidgetContext::eraseVisibleRange(uint32_t element_) {
+	// remove element_ and its visible children from mVisibleWidgets.
+	compactVisible();
+	auto first = mRegistry[element_].visibleIndex;
+	if (first == WidgetRegistry::npos)
+		return;
+	auto last = first + 1 + mRegistry[element_].visibleChildren;
+	for (auto i = first; i != last; ++i) {
+		mRegistry[mVisibleWidgets[i].index].visibleIndex = WidgetRegistry::npos;
+	}
+	++mVisibleWidgetsVersion;
+	mVisibleWidgets.erase(mVisibleWidgets.begin() + first, mVisibleWidgets.begin() + last);
+	reindexVisible(first, mVisibleWidgets.size());
+}
+
+// ----------------------------------------------------------------------
+
+void WidgetContext::insertVisibleRange(uint32_t element_, size_t pos_) {
+	// insert element_ and its visible children into mVisibleWidgets,
+	// right before pos_. 
+
+	// walking the widget list from element_ towards the front gives
+	// us its range back to front, and lets us skip invisible children.
+	compactVisible();
+	static thread_local std::vector<ofxWidgetHandle> range;
+	range.clear();
+	auto end = mRegistry[mRegistry[element_].first].prev;
+	for (auto i = element_; i != end; ) {
+		auto & slot = mRegistry[i];
+		if (slot.widget->getVisibility()) {
+			range.push_back(ofxWidgetHandle(i, slot.generation));
+			i = slot.prev;
+		} else {
+			i = mRegistry[slot.first].prev; // skip over the widget's children
+		}
+	}
+	mVisibleWidgets.insert(mVisibleWidgets.begin() + pos_, range.begin(), range.end());
+	reindexVisible(pos_, mVisibleWidgets.size());
+}
+
+// ----------------------------------------------------------------------
+
+void WidgetContext::moveVisibleRange(uint32_t element_, size_t pos_) {
+	// move the visible range of element_ so that it ends right 
+	// before pos_ if pos_ lies after the range, or so that it 
+	// starts at pos_ if pos_ lies before the range.
+	compactVisible();
+	size_t first = mRegistry[element_].visibleIndex;
+	size_t last = first + 1 + mRegistry[element_].visibleChildren;
+	// hit test bounds which are up to date follow along, so that 
+	// (un)parenting a widget doesn't make them rebuild.
+	bool moveBounds = (mHitBounds.mVisibleWidgetsVersion == mVisibleWidgetsVersion);
+	if (pos_ < first) {
+		rotateRange(mVisibleWidgets, pos_, first, last);
+		reindexVisible(pos_, last);
+		if (moveBounds)
+			mHitBounds.rotate(pos_, first, last);
+	} else if (pos_ > last) {
+		rotateRange(mVisibleWidgets, first, last, pos_);
+		reindexVisible(first, pos_);
+		if (moveBounds)
+			mHitBounds.rotate(first, last, pos_);
+	}
+	if (moveBounds)
+		mHitBounds.mVisibleWidgetsVersion = mVisibleWidgetsVersion;
+}
+
+// ----------------------------------------------------------------------
+
+void WidgetContext::raiseVisibleRanges(uint32_t element_) {
+	// move the visible range of element_ to the back of its parent's 
+	// visible range, the parent's range to the back of its own parent's,
+	// and so on, up to the back of the list - which is what raising 
+	// element_ does to the visible list. 
+	//
+	// instead of moving one range per level, we put together the final 
+	// order in one go, starting at the topmost range which actually 
+	// moves: widgets outside of that range's parent range stay where 
+	// they are, and so do widgets in front of it. this costs O(depth),
+	// plus the size of the parent range from the moved range onwards.
+
+	compactVisible();
+
+	// visible ranges of element_ and its ancestors, innermost first.
+	// nothing below a hidden widget is in the list, so these end up 
+	// being consecutive levels, up to the top.
+	static thread_local std::vector<uint32_t> levels;
+	levels.clear();
+	for (auto e = element_; e != WidgetRegistry::npos; e = mRegistry[e].parent) {
+		if (mRegistry[e].visibleIndex != WidgetRegistry::npos)
+			levels.push_back(e);
+	}
+
+	auto first = [this](uint32_t e_) {
+		return size_t(mRegistry[e_].visibleIndex);
+	};
+	auto last = [this](uint32_t e_) {
+		return size_t(mRegistry[e_].visibleIndex) + 1 + mRegistry[e_].visibleChildren;
+	};
+
+	// find the topmost range which is not yet at the back of its parent
+	// range - or of the list. 
+	size_t top = levels.size();
+	size_t parentLast = mVisibleWidgets.size();
+	for (size_t i = levels.size(); i-- > 0; ) {
+		if (last(levels[i]) != parentLast) {
+			top = i;
+			break;
+		}
+		parentLast = last(levels[i]);
+	}
+
+	if (top == levels.size())
+		return; // visible order doesn't change.
+
+	// widgets in front of the top range come first, then each level's 
+	// range, minus the range of the level below it, which goes last.
+	static thread_local std::vector<std::pair<size_t, size_t>> pieces;
+	pieces.clear();
+	pieces.emplace_back(last(levels[top]), parentLast);
+	for (size_t i = top; i > 0; --i) {
+		pieces.emplace_back(first(levels[i]), first(levels[i - 1]));
+		pieces.emplace_back(last(levels[i - 1]), last(levels[i]));
+	}
+	pieces.emplace_back(first(levels[0]), last(levels[0]));
+
+	// hit test bounds which are up to date follow along, so that raising
+	// a widget doesn't make them rebuild.
+	bool moveBounds = (mHitBounds.mVisibleWidgetsVersion == mVisibleWidgetsVersion);
+	auto pos = first(levels[top]);
+	gatherRanges(mVisibleWidgets, pos, pieces);
+	reindexVisible(pos, parentLast);
+	if (moveBounds) {
+		mHitBounds.gather(pos, pieces);
+		mHitBounds.mVisibleWidgetsVersion = mVisibleWidgetsVersion;
+	}
+}
+
+// ----------------------------------------------------------------------
+
+size_t WidgetContext::visibleEndOf(uint32_t element_) {
+	// index right after the visible range of element_. 
+	// element_ must be visible.
+	compactVisible();
+	return mRegistry[element_].visibleIndex + mRegistry[element_].visibleChildren + 1;
+}
+
+// ----------------------------------------------------------------------
+
+size_t WidgetContext::visibleInsertPosition(uint32_t element_) {
+	// where the visible range of element_ belongs in mVisibleWidgets:
+	// right after the range of its nearest visible sibling behind it, 
+	// or right after its parent, if there is no such sibling.
+	compactVisible();
+	auto parent = mRegistry[element_].parent;
+	for (auto i = mRegistry[element_].next; i != WidgetRegistry::npos && i != parent; ) {
+		// i is the first element of the range of the next sibling 
+		// behind us - travel up to find that sibling.
+		auto sibling = i;
+		while (mRegistry[sibling].parent != parent)
+			sibling = mRegistry[sibling].parent;
+		if (mRegistry[sibling].visibleIndex != WidgetRegistry::npos)
+			return visibleEndOf(sibling);
+		i = mRegistry[sibling].next;
+	}
+	return (parent == WidgetRegistry::npos ? 0 : mRegistry[parent].visibleIndex + 1);
+}
+
+// ----------------------------------------------------------------------
+
+void WidgetContext::addVisibleChildren(uint32_t parent_, int64_t delta_) {
+	// a range of delta_ visible widgets was added to (or removed from) 
+	// the children of parent_. update visible child counts for parent_, 
+	// and for its ancestors up to the first invisible one.
+	++mVisibleWidgetsVersion; // visible ranges change, even if the list itself might not.
+	for (auto a = parent_; a != WidgetRegistry::npos; a = mRegistry[a].parent) {
+		mRegistry[a].visibleChildren = uint32_t(mRegistry[a].visibleChildren + delta_);
+		if (!mRegistry[a].widget->getVisibility())
+			break;
+	}
+}
+
+// ----------------------------------------------------------------------
+
+bool covers(const ofRectangle& outer_, const ofRectangle& inner_) {
+	// inclusive containment - a widget exactly behind an opaque
+	// widget of the same size counts as covered.
+	return inner_.getMinX() >= outer_.getMinX() && inner_.getMaxX() <= outer_.getMaxX()
+		&& inner_.getMinY() >= outer_.getMinY() && inner_.getMaxY() <= outer_.getMaxY();
+}
+
+// ----------------------------------------------------------------------
+
+bool WidgetContext::isClippedAt(uint32_t element_, float x_, float y_) {
+	// whether x_, y_ lies outside the rect of any ancestor of 
+	// element_ which clips its children.
+	if (mNumClippingWidgets == 0)
+		return false;
+	for (auto a = mRegistry[element_].parent; a != WidgetRegistry::npos; a = mRegistry[a].parent) {
+		auto w = mRegistry[a].widget;
+		if (w->getClipChildren() && !w->getRect().inside(x_, y_))
+			return true;
+	}
+	return false;
+}
+
+// ----------------------------------------------------------------------
+
+void WidgetContext::clipFrameWidgets() {
+	// mark frame snapshot widgets which are fully clipped by an 
+	// ancestor, and store the unclipped part of every widget's rect. 
+	// the snapshot is back to front, so parents come right before 
+	// their children, and we can keep clip rects on a stack.
+	// if a widget which clips its children is fully clipped itself,
+	// we skip its whole range.
+
+	struct Clip {
+		size_t      end;  // end of the range this clip rect applies to
+		ofRectangle rect;
+	};
+	static thread_local std::vector<Clip> clips;
+	clips.clear();
+
+	mFrameClippedRects.resize(mFrameWidgets.size());
+
+	for (size_t i = 0; i < mFrameWidgets.size(); ) {
+		while (!clips.empty() && clips.back().end <= i)
+			clips.pop_back();
+
+		auto w = mFrameWidgets[i];
+		const auto & rect = w->getRect();
+		bool isClipped = false;
+
+		if (clips.empty()) {
+			mFrameClippedRects[i] = rect;
+		} else {
+			isClipped = !clips.back().rect.intersects(rect);
+			mFrameClippedRects[i] = (isClipped ? ofRectangle() : clips.back().rect.getIntersection(rect));
+		}
+
+		if (isClipped)
+			mFrameCulled[i] = 1;
+
+		if (w->getClipChildren()) {
+			if (isClipped) {
+				for (auto end = mFrameRangeEnds[i]; i < end; ++i)
+					mFrameCulled[i] = 1;
+				continue;
+			}
+			clips.push_back({ mFrameRangeEnds[i], mFrameClippedRects[i] });
+		}
+		++i;
+	}
+}
+
+// ----------------------------------------------------------------------
+
+void WidgetContext::cullFrameWidgets(const ofRectangle& viewport_, bool useClippedRects_) {
+	// mark frame snapshot widgets which lie outside viewport_, or 
+	// which are fully covered by a single opaque widget in front of 
+	// them. walking front to back means all potential occluders of a 
+	// widget have been seen by the time we get to it. children are in
+	// front of their parents, so a parent never occludes its children.
+
+	// we only keep the largest few occluders, which keeps culling 
+	// linear in the number of widgets. 
+	static const size_t kMaxOccluders = 16;
+	static thread_local std::vector<ofRectangle> occluders;
+	occluders.clear();
+
+	for (auto i = mFrameWidgets.size(); i-- > 0; ) {
+		auto w = mFrameWidgets[i];
+		if (!w->getHandle().isValid() || mFrameCulled[i])
+			continue;
+		const auto & rect = (useClippedRects_ ? mFrameClippedRects[i] : w->getRect());
+
+		if (!viewport_.intersects(rect)) {
+			mFrameCulled[i] = 1;
+			continue;
+		}
+
+		bool isCovered = false;
+		for (const auto & o : occluders) {
+			if (covers(o, rect)) {
+				isCovered = true;
+				break;
+			}
+		}
+		if (isCovered) {
+			mFrameCulled[i] = 1;
+			continue;
+		}
+
+		if (!w->getOpaque())
+			continue;
+
+		if (occluders.size() < kMaxOccluders) {
+			occluders.push_back(rect);
+		} else {
+			auto smallest = std::min_element(occluders.begin(), occluders.end(), [](const ofRectangle& lhs, const ofRectangle& rhs) {
+				return lhs.getArea() < rhs.getArea();
+			});
+			if (smallest->getArea() < rect.getArea())
+				*smallest = rect;
+		}
+	}
+}
+
+// ----------------------------------------------------------------------
+
+class WidgetPass {
+	// scope guard for draw and update passes: makes sure the frame 
+	// snapshot is up to date when the outermost pass begins, and 
+	// frees widgets which were released during the pass once the 
+	// outermost pass ends.
+	// the context is made current for the duration of the pass, 
+	// so that callbacks which make widgets make them in there.
+	WidgetContext& c;
+	ofxWidgetContext::Scope mScope;
+public:
+	WidgetPass(WidgetContext& context_)
+		: c(context_)
+		, mScope(context_) {
+		if (c.mPassDepth++ == 0 && c.mFrameWidgetsVersion != c.mVisibleWidgetsVersion) {
+			c.compactVisible();
+			c.mFrameWidgets.clear();
+			c.mFrameRangeEnds.clear();
+			for (const auto & h : c.mVisibleWidgets) {
+				c.mFrameWidgets.push_back(c.mRegistry[h.index].widget);
+				c.mFrameRangeEnds.push_back(uint32_t(c.visibleEndOf(h.index)));
+			}
+			c.mFrameWidgetsVersion = c.mVisibleWidgetsVersion;
+		}
+	}
+	~WidgetPass() {
+		if (--c.mPassDepth == 0) {
+			while (!c.mDeferredReleases.empty()) {
+				auto w = c.mDeferredReleases.back();
+				c.mDeferredReleases.pop_back();
+				c.deleteWidget(w);
+			}
+		}
+	}
+};
+
+// ----------------------------------------------------------------------
+
+WidgetEventResponder::WidgetEventResponder(WidgetContext& context_, ofCoreEvents& events_)
+	: mContext(context_)
+	, mEvents(events_)
+{
+	auto listener = this;
+	auto prio = OF_EVENT_ORDER_AFTER_APP;
+
+	ofAddListener(mEvents.mouseDragged, listener, &WidgetEventResponder::mouseEvent, prio);
+	ofAddListener(mEvents.mouseMoved, listener, &WidgetEventResponder::mouseEvent, prio);
+	ofAddListener(mEvents.mousePressed, listener, &WidgetEventResponder::mouseEvent, prio);
+	ofAddListener(mEvents.mouseReleased, listener, &WidgetEventResponder::mouseEvent, prio);
+	ofAddListener(mEvents.mouseScrolled, listener, &WidgetEventResponder::mouseEvent, prio);
+	ofAddListener(mEvents.mouseEntered, listener, &WidgetEventResponder::mouseEvent, prio);
+	ofAddListener(mEvents.mouseExited, listener, &WidgetEventResponder::mouseEvent, prio);
+
+	ofAddListener(mEvents.touchDown, listener, &WidgetEventResponder::touchEvent, prio);
+	ofAddListener(mEvents.touchMoved, listener, &WidgetEventResponder::touchEvent, prio);
+	ofAddListener(mEvents.touchUp, listener, &WidgetEventResponder::touchEvent, prio);
+	ofAddListener(mEvents.touchDoubleTap, listener, &WidgetEventResponder::touchEvent, prio);
+	ofAddListener(mEvents.touchCancelled, listener, &WidgetEventResponder::touchEvent, prio);
+
+	// now add key event listeners
+
+	ofAddListener(mEvents.keyPressed, listener, &WidgetEventResponder::keyEvent, prio);
+	ofAddListener(mEvents.keyReleased, listener, &WidgetEventResponder::keyEvent, prio);
+
+	ofLogVerbose() << "adding widget listener";
+}
+// ----------------------------------------------------------------------
+
+WidgetEventResponder::~WidgetEventResponder()
+{
+	auto listener = this;
+	auto prio = OF_EVENT_ORDER_AFTER_APP;
+
+	ofRemoveListener(mEvents.keyReleased, listener, &WidgetEventResponder::keyEvent, prio);
+	ofRemoveListener(mEvents.keyPressed, listener, &WidgetEventResponder::keyEvent, prio);
+
+	ofRemoveListener(mEvents.touchCancelled, listener, &WidgetEventResponder::touchEvent, prio);
+	ofRemoveListener(mEvents.touchDoubleTap, listener, &WidgetEventResponder::touchEvent, prio);
+	ofRemoveListener(mEvents.touchUp, listener, &WidgetEventResponder::touchEvent, prio);
+	ofRemoveListener(mEvents.touchMoved, listener, &WidgetEventResponder::touchEvent, prio);
+	ofRemoveListener(mEvents.touchDown, listener, &WidgetEventResponder::touchEvent, prio);
+
+	ofRemoveListener(mEvents.mouseExited, listener, &WidgetEventResponder::mouseEvent, prio);
+	ofRemoveListener(mEvents.mouseEntered, listener, &WidgetEventResponder::mouseEvent, prio);
+	ofRemoveListener(mEvents.mouseScrolled, listener, &WidgetEventResponder::mouseEvent, prio);
+	ofRemoveListener(mEvents.mouseReleased, listener, &WidgetEventResponder::mouseEvent, prio);
+	ofRemoveListener(mEvents.mousePressed, listener, &WidgetEventResponder::mouseEvent, prio);
+	ofRemoveListener(mEvents.mouseMoved, listener, &WidgetEventResponder::mouseEvent, prio);
+	ofRemoveListener(mEvents.mouseDragged, listener, &WidgetEventResponder::mouseEvent, prio);
+
+}
+
+// ----------------------------------------------------------------------
+
+bool WidgetEventResponder::mouseEvent(ofMouseEventArgs & args_)
+{
+	auto & c = mContext;
+	if (!c.bInputBatching)
+		return c.mouseEvent(args_);
+
+	bool isMotion = (args_.type == ofMouseEventArgs::Moved || args_.type == ofMouseEventArgs::Dragged);
+	if (isMotion && !c.mInputQueue.empty()) {
+		auto & last = c.mInputQueue.back();
+		if (last.isMouseEvent && last.mouse.type == args_.type && last.mouse.button == args_.button) {
+			last.mouse = args_; // coalesce
+			return false;
+		}
+	}
+	c.mInputQueue.push_back({ true, args_, ofKeyEventArgs() });
+
+	// we can't know yet whether a widget will attend to this event.
+	return false;
+}
+
+// ----------------------------------------------------------------------
+
+bool WidgetEventResponder::touchEvent(ofTouchEventArgs & args_)
+{
+	mContext.queueTouchEvent(args_);
 
-// a list of visible widgets
-list<weak_ptr<ofxWidget>>	   sVisibleWidgets;
-bool ofxWidget::bVisibleListDirty = true; // whether the cache needs to be re-built upon update.
+	// we can't know yet whether a widget will attend to this event.
+	return false;
+}
+
+// ----------------------------------------------------------------------
+
+bool WidgetEventResponder::keyEvent(ofKeyEventArgs & args_)
+{
+	auto & c = mContext;
+	if (!c.bInputBatching)
+		return c.keyEvent(args_);
+
+	// key events are queued, too, so that they don't overtake 
+	// mouse events which might change the focus.
+	c.mInputQueue.push_back({ false, ofMouseEventArgs(), args_ });
+	return false;
+}
 
-// the widget that is in focus and will receive interactions.
-weak_ptr<ofxWidget>			   sFocusedWidget;
-weak_ptr<ofxWidget>			   sWidgetUnderMouse;
+// ----------------------------------------------------------------------
 
-ofVec2f ofxWidget::sLastMousePos{ 0.f,0.f };
+void WidgetContext::initEventResponder() {
+	// register for mouse events
+	// the default context does this when its first widget gets initialised.
+	if (bListenToAppEvents) {
+		bListenToAppEvents = false;
+		if (!mResponder)
+			listenTo(ofEvents());
+	}
+}
 
 // ----------------------------------------------------------------------
 
-bool isSame(const weak_ptr<ofxWidget> &lhs, const weak_ptr<ofxWidget>&rhs) {
-	return (!lhs.expired() && !rhs.expired() && (!rhs.owner_before(lhs) && !lhs.owner_before(rhs)));
+ofxWidgetContext::ofxWidgetContext() {
+	static std::atomic<uint64_t> nextId(1);
+	mId = nextId.fetch_add(1, std::memory_order_relaxed);
 }
 
 // ----------------------------------------------------------------------
 
-auto findIt(const weak_ptr<ofxWidget>& needle_,
-	const list<weak_ptr<ofxWidget>>::iterator start_,
-	const list<weak_ptr<ofxWidget>>::iterator end_) {
-	// find needle in widget list haystack
-	return find_if(start_, end_, [needle = needle_](weak_ptr<ofxWidget>&w) {
-		// finds if it two shared ptrs are the same.
-		return (!w.owner_before(needle) && !needle.owner_before(w));
-	});
+WidgetContext::~WidgetContext() {
+	if (mRegistry.front() != WidgetRegistry::npos)
+		ofLogWarning() << "Widget context destroyed while widgets still live in it.";
+}
+
+// ----------------------------------------------------------------------
+
+std::shared_ptr<ofxWidgetContext> ofxWidgetContext::make() {
+	return std::make_shared<WidgetContext>();
+}
+
+// ----------------------------------------------------------------------
+
+ofxWidgetContext& ofxWidgetContext::getDefault() {
+	// never destroyed, so that widgets which outlive main() 
+	// still find their context.
+	static auto context = [] {
+		auto c = new WidgetContext();
+		c->bListenToAppEvents = true;
+		return c;
+	}();
+	return *context;
+}
+
+// ----------------------------------------------------------------------
+
+ofxWidgetContext& ofxWidgetContext::getCurrent() {
+	return (tCurrentContext ? *tCurrentContext : getDefault());
+}
+
+// ----------------------------------------------------------------------
+
+ofxWidgetContext::Scope::Scope(ofxWidgetContext& context_)
+	: mPrevious(tCurrentContext) {
+	tCurrentContext = &context_;
+}
+
+// ----------------------------------------------------------------------
+
+ofxWidgetContext::Scope::~Scope() {
+	tCurrentContext = mPrevious;
+}
+
+// ----------------------------------------------------------------------
+
+void ofxWidgetContext::listenTo(ofCoreEvents& events_) {
+	auto & c = static_cast<WidgetContext&>(*this);
+	c.bListenToAppEvents = false;
+	c.mResponder.reset(); // a context listens to one set of events at a time
+	c.mResponder.reset(new WidgetEventResponder(c, events_));
+}
+
+// ----------------------------------------------------------------------
+
+void ofxWidgetContext::stopListening() {
+	auto & c = static_cast<WidgetContext&>(*this);
+	c.bListenToAppEvents = false;
+	c.mResponder.reset();
+}
+
+// ----------------------------------------------------------------------
+
+void ofxWidgetContext::update() {
+	static_cast<WidgetContext&>(*this).update();
+}
+
+// ----------------------------------------------------------------------
+
+void ofxWidgetContext::draw() {
+	static_cast<WidgetContext&>(*this).draw();
+}
+
+// ----------------------------------------------------------------------
+
+bool ofxWidgetContext::postMouseEvent(const ofMouseEventArgs& args_) {
+	return static_cast<WidgetContext&>(*this).mPostedInput.push({ true, args_, ofKeyEventArgs() });
+}
+
+// ----------------------------------------------------------------------
+
+bool ofxWidgetContext::postKeyEvent(const ofKeyEventArgs& args_) {
+	return static_cast<WidgetContext&>(*this).mPostedInput.push({ false, ofMouseEventArgs(), args_ });
+}
+
+// ----------------------------------------------------------------------
+
+std::shared_ptr<ofxWidget> WidgetContext::newWidget() {
+#ifndef OFX_WIDGET_NO_POOL
+	mWidgetPool.fits(sizeof(ofxWidget));
+	auto w = new (mWidgetPool.allocate()) ofxWidget();
+	w->mContext = this;
+	return std::shared_ptr<ofxWidget>(w, &ofxWidget::release, WidgetPoolAllocator<ofxWidget>(mControlBlockPool));
+#else
+	// plain heap allocations - which lets memory checkers see each widget.
+	auto w = new ofxWidget();
+	w->mContext = this;
+	return std::shared_ptr<ofxWidget>(w, &ofxWidget::release);
+#endif
+}
+
+// ----------------------------------------------------------------------
+
+void WidgetContext::deleteWidget(ofxWidget* w_) {
+#ifndef OFX_WIDGET_NO_POOL
+	w_->~ofxWidget();
+	mWidgetPool.deallocate(w_);
+#else
+	delete w_;
+#endif
+}
+
+// ----------------------------------------------------------------------
+// widgets may only be created through this factory function
+shared_ptr<ofxWidget> ofxWidget::make(const ofRectangle& rect_) {
+	auto & c = WidgetContext::current();
+	c.initEventResponder();
+
+	auto widget = c.newWidget();
+	widget->mLocalRect = rect_;
+	widget->mRect = rect_;
+	widget->mThis = widget; // widget keeps weak store to self - will this make it leak?
+	// it should not, since the widget and its control block are allocated separately, 
+	// and not as one block like make_shared would do.
+
+	widget->mHandle = c.mRegistry.add(widget.get()); // registers the new object at the front of our list
+	if (c.mHitGrid.bEnabled)
+		c.mHitGrid.insert(widget->mHandle.index, rect_);
+
+	// new widgets are visible, and in front of all others.
+	c.mVisibleWidgets.push_back(widget->mHandle);
+	c.mRegistry[widget->mHandle.index].visibleIndex = uint32_t(c.mVisibleWidgets.size() - 1);
+	++c.mVisibleWidgetsVersion;
+	return widget;
+}
+
+// ----------------------------------------------------------------------
+
+std::vector<shared_ptr<ofxWidget>> ofxWidget::makeTree(const std::vector<ofRectangle>& rects_, const std::vector<int>& parents_, const std::shared_ptr<ofxWidget>& parent_) {
+	// this builds the same widget hierarchy as calling make() for every 
+	// rect, followed by setParent() for every widget which has a parent
+	// - but instead of moving widget ranges one by one, we lay out the 
+	// subtree's range in one go, and then splice it into the widget 
+	// list, and into the list of visible widgets.
+
+	auto & c = (parent_ ? parent_->context() : WidgetContext::current());
+
+	std::vector<shared_ptr<ofxWidget>> widgets;
+
+	if (rects_.size() != parents_.size()) {
+		ofLogError() << "makeTree: need one parent index per rect.";
+		return widgets;
+	}
+
+	auto numWidgets = rects_.size();
+
+	for (size_t i = 0; i < numWidgets; ++i) {
+		if (parents_[i] >= int(i) || parents_[i] < -1) {
+			ofLogError() << "makeTree: parent index for widget " << i << " must be -1, or refer to a widget before it.";
+			return widgets;
+		}
+	}
+
+	auto root = WidgetRegistry::npos; // slot of parent_, if any
+	if (parent_) {
+		if (c.mRegistry.get(parent_->mHandle) == nullptr) {
+			ofLogError() << "makeTree: parent widget is not registered.";
+			return widgets;
+		}
+		root = parent_->mHandle.index;
+	}
+
+	if (numWidgets == 0)
+		return widgets;
+
+	// ---------| invariant: description is valid, and not empty.
+
+	c.initEventResponder();
+
+	widgets.reserve(numWidgets);
+	std::vector<uint32_t> slots(numWidgets);
+
+	for (size_t i = 0; i < numWidgets; ++i) {
+		auto widget = c.newWidget();
+		widget->mLocalRect = rects_[i];
+		widget->mRect = rects_[i];
+		widget->mThis = widget;
+		widget->mHandle = c.mRegistry.allocate(widget.get());
+		slots[i] = widget->mHandle.index;
+		if (parents_[i] >= 0) {
+			widget->mParent = widgets[parents_[i]];
+			widget->mLocalRect.position -= rects_[parents_[i]].position;
+			c.mRegistry[slots[i]].parent = slots[parents_[i]];
+		} else {
+			widget->mParent = parent_;
+			if (parent_)
+				widget->mLocalRect.position -= parent_->getRect().position;
+			c.mRegistry[slots[i]].parent = root;
+		}
+		if (c.mHitGrid.bEnabled)
+			c.mHitGrid.insert(slots[i], rects_[i]);
+		widgets.push_back(std::move(widget));
+	}
+
+	// children always come after their parents, so we can 
+	// accumulate child counts walking backwards.
+	for (auto i = numWidgets; i-- > 0; ) {
+		if (parents_[i] >= 0)
+			widgets[parents_[i]]->mNumChildren += 1 + widgets[i]->mNumChildren;
+	}
+
+	// group children by parent (the extra bucket at the end is 
+	// for top-level widgets), keeping them in description order.
+	std::vector<uint32_t> childStart(numWidgets + 3, 0);
+	std::vector<uint32_t> children(numWidgets);
+	auto bucket = [&parents_, &numWidgets](size_t i_) -> size_t {
+		return parents_[i_] >= 0 ? size_t(parents_[i_]) : numWidgets;
+	};
+	for (size_t i = 0; i < numWidgets; ++i)
+		++childStart[bucket(i) + 2];
+	for (size_t i = 2; i < childStart.size(); ++i)
+		childStart[i] += childStart[i - 1];
+	for (size_t i = 0; i < numWidgets; ++i)
+		children[childStart[bucket(i) + 1]++] = uint32_t(i);
+
+	// now lay out the subtree range front to back: a widget's range 
+	// holds the ranges of its children, the most recently added child
+	// in front, followed by the widget itself.
+	std::vector<uint32_t> order;
+	order.reserve(numWidgets);
+	{
+		struct Frame {
+			size_t   widget;
+			uint32_t nextChild; // counts down, so that we visit the frontmost child first
+		};
+		std::vector<Frame> stack;
+		stack.push_back({ numWidgets, childStart[numWidgets + 1] });
+		while (!stack.empty()) {
+			auto & top = stack.back();
+			auto firstChild = childStart[top.widget];
+			if (top.nextChild != firstChild) {
+				auto child = children[--top.nextChild];
+				stack.push_back({ child, childStart[child + 1] });
+			} else {
+				if (top.widget != numWidgets)
+					order.push_back(uint32_t(top.widget));
+				stack.pop_back();
+			}
+		}
+	}
+
+	// thread the range through the registry slots. a widget's range 
+	// starts where the range of its first child in the layout starts.
+	for (size_t i = 0; i < numWidgets; ++i) {
+		auto & slot = c.mRegistry[slots[order[i]]];
+		slot.prev = (i == 0 ? WidgetRegistry::npos : slots[order[i - 1]]);
+		slot.next = (i + 1 == numWidgets ? WidgetRegistry::npos : slots[order[i + 1]]);
+		slot.visibleChildren = uint32_t(widgets[order[i]]->mNumChildren); // new widgets are all visible
+	}
+	for (auto w : order) {
+		// walking front to back, the first child we meet for each 
+		// parent is its frontmost child - and that child's range 
+		// start is known already, since its children came before it.
+		if (parents_[w] >= 0 && c.mRegistry[slots[parents_[w]]].first == slots[parents_[w]])
+			c.mRegistry[slots[parents_[w]]].first = c.mRegistry[slots[w]].first;
+	}
+
+	auto first = slots[order.front()];
+	auto last = slots[order.back()];
+
+	// splice the range into the widget list, at the front of 
+	// parent_'s child range, or at the front of the list.
+	auto pos = (root == WidgetRegistry::npos ? c.mRegistry.front() : c.mRegistry[root].first);
+	c.mRegistry.link(first, last, pos);
+	for (auto a = root; a != WidgetRegistry::npos; a = c.mRegistry[a].parent) {
+		c.mRegistry[a].widget->mNumChildren += numWidgets;
+		if (c.mRegistry[a].first == pos)
+			c.mRegistry[a].first = first;
+	}
+
+	// the visible range is our layout, reversed: back to front.
+	if (root == WidgetRegistry::npos || c.mRegistry[root].visibleIndex != WidgetRegistry::npos) {
+		size_t visiblePos = (root == WidgetRegistry::npos ? c.mVisibleWidgets.size() : c.visibleEndOf(root));
+		c.mVisibleWidgets.insert(c.mVisibleWidgets.begin() + visiblePos, numWidgets, ofxWidgetHandle());
+		for (size_t i = 0; i < numWidgets; ++i)
+			c.mVisibleWidgets[visiblePos + i] = widgets[order[numWidgets - 1 - i]]->mHandle;
+		c.reindexVisible(visiblePos, c.mVisibleWidgets.size());
+	}
+	c.addVisibleChildren(root, int64_t(numWidgets));
+
+	return widgets;
+}
+
+// ----------------------------------------------------------------------
+
+std::shared_ptr<ofxWidget> WidgetContext::fromHandle(const ofxWidgetHandle & handle_) {
+	if (auto w = mRegistry.get(handle_))
+		return w->mThis.lock();
+	return nullptr;
+}
+
+// ----------------------------------------------------------------------
+
+std::shared_ptr<ofxWidget> ofxWidget::fromHandle(const ofxWidgetHandle & handle_) {
+	return WidgetContext::current().fromHandle(handle_);
+}
+
+// ----------------------------------------------------------------------
+
+ofxWidget::ofxWidget() {
+}
+
+// ----------------------------------------------------------------------
+// deleter for widget shared_ptrs.
+void ofxWidget::release(ofxWidget* w_) {
+	auto & c = w_->context();
+	// unregister right away - but if a draw or update pass is running, 
+	// keep the widget's memory around until the pass is over, since
+	// the frame snapshot might still point to it, and the widget 
+	// might have released itself from within one of its callbacks.
+	w_->unregister();
+	if (c.mPassDepth > 0) {
+		c.mDeferredReleases.push_back(w_);
+	} else {
+		c.deleteWidget(w_);
+	}
+}
+
+// ----------------------------------------------------------------------
+
+ofxWidget::~ofxWidget() {
+	if (mClipChildren)
+		--context().mNumClippingWidgets;
+	unregister();
+}
+
+// ----------------------------------------------------------------------
+
+void ofxWidget::unregister() {
+	auto & c = context();
+
+	// Q: what if the parent gets destroyed first?
+
+	// A: We should be fine.
+
+	// the parent will remove elements from our widget list,
+	// and release the registry slots of our widget and its 
+	// siblings. if that is the case, our handle won't resolve 
+	// anymore, and we won't delete anything from that list.
+
+	if (c.mRegistry.get(mHandle) == this) {
+
+		// we have found ourselves. now, we need to delete our object range from 
+		// our context's list of widgets.
+
+		auto me = mHandle.index;
+		auto first = c.mRegistry[me].first;
+		auto after = c.mRegistry[me].next;
+
+		// we, and our children, won't have a parent to be relative 
+		// to anymore: keep rects where they are on screen. since
+		// children come before their parents, all ancestors are 
+		// still around when we ask for a child's rect.
+		for (auto i = first; ; i = c.mRegistry[i].next) {
+			auto w = c.mRegistry[i].widget;
+			w->mLocalRect = w->getRect();
+			if (i == me)
+				break;
+		}
+
+		if (c.mRegistry[me].visibleIndex != WidgetRegistry::npos) {
+			// leave tombstones - visible child counts of our ancestors
+			// get fixed once the tombstones are compacted.
+			c.tombstoneVisibleRange(me);
+		} else if (mVisible) {
+			// we are hidden by an invisible ancestor.
+			c.addVisibleChildren(c.mRegistry[me].parent, -int64_t(1 + c.mRegistry[me].visibleChildren));
+		}
+
+		// if the focus is within our range, it goes away with us - and
+		// our ancestors don't contain it anymore.
+		if (c.mRegistry[me].containsFocus && c.mRegistry[me].parent != WidgetRegistry::npos)
+			c.markFocusPath(c.mRegistry[me].parent, false);
+
+		// let's see if we have a parent
+		for (auto a = c.mRegistry[me].parent; a != WidgetRegistry::npos; a = c.mRegistry[a].parent) {
+			// decrement the parent's child number by (mNumChildren+1), recursively
+			c.mRegistry[a].widget->mNumChildren -= (mNumChildren + 1);
+			// ancestors which started with our range now start with 
+			// whatever followed our range.
+			if (c.mRegistry[a].first == first)
+				c.mRegistry[a].first = after;
+		}
+
+		c.mRegistry.unlink(first, me);
+
+		// children are orphaned together with our range: 
+		// release their registry slots, too. touches can't find
+		// orphans anymore, so they don't count as touched.
+		for (auto i = first; i != me; ) {
+			auto next = c.mRegistry[i].next;
+			c.mRegistry[i].widget->mHandle = ofxWidgetHandle();
+			c.mRegistry[i].widget->mNumTouches = 0;
+			c.mHitGrid.remove(i);
+			c.mRegistry.remove(i);
+			i = next;
+		}
+
+		c.mHitGrid.remove(me);
+		c.mRegistry.remove(me);
+		mHandle = ofxWidgetHandle();
+		mNumTouches = 0;
+	} 
 }
 
 // ----------------------------------------------------------------------
 
-WidgetEventResponder::WidgetEventResponder()
+void ofxWidget::setParent(std::shared_ptr<ofxWidget>& p_)
 {
-	auto listener = this;
-	auto prio = OF_EVENT_ORDER_AFTER_APP;
+	auto & c = context();
 
-	ofAddListener(ofEvents().mouseDragged, listener, &WidgetEventResponder::mouseEvent, prio);
-	ofAddListener(ofEvents().mouseMoved, listener, &WidgetEventResponder::mouseEvent, prio);
-	ofAddListener(ofEvents().mousePressed, listener, &WidgetEventResponder::mouseEvent, prio);
-	ofAddListener(ofEvents().mouseReleased, listener, &WidgetEventResponder::mouseEvent, prio);
-	ofAddListener(ofEvents().mouseScrolled, listener, &WidgetEventResponder::mouseEvent, prio);
-	ofAddListener(ofEvents().mouseEntered, listener, &WidgetEventResponder::mouseEvent, prio);
-	ofAddListener(ofEvents().mouseExited, listener, &WidgetEventResponder::mouseEvent, prio);
+	if (p_ && p_->mContext != mContext) {
+		// handles are only meaningful within their own context.
+		ofLogWarning() << "Widget cannot be parented to a widget of another context!";
+		return;
+	}
 
-	// now add key event listeners
+	if (!p_ || c.mRegistry.get(p_->mHandle) == nullptr || c.mRegistry.get(mHandle) == nullptr)
+		return;
 
-	ofAddListener(ofEvents().keyPressed, listener, &WidgetEventResponder::keyEvent, prio);
-	ofAddListener(ofEvents().keyReleased, listener, &WidgetEventResponder::keyEvent, prio);
+	auto me = mHandle.index;
+	auto parent = p_->mHandle.index;
 
-	ofLogVerbose() << "adding widget listener";
+	for (auto a = parent; a != WidgetRegistry::npos; a = c.mRegistry[a].parent) {
+		if (a == me) {
+			ofLogWarning() << "Widget cannot be parented to one of its own children!";
+			return;
+		}
+	}
+
+	if (c.mRegistry[me].parent == parent)
+		return; // nothing to do.
+
+	// if we have a parent already, we first become a top-level 
+	// widget, and then move on to our new parent from there.
+	unparent();
+
+	/*
+
+	When an object gets a parent,
+
+	1. move it to the beginning of the parent's child range.
+	2. set its parent pointer
+	3. increase parent's child count by number of (own children + 1 ), recursively.
+
+	*/
+
+	// our rect stays where it is on screen, which means it moves
+	// relative to the new parent.
+	mLocalRect.position = getRect().position - p_->getRect().position;
+
+	// move current element and its children to the front of the new parent's child range
+	c.moveRangeToFrontOf(me, parent);
+
+	// do the same for our visible range, if any.
+	if (c.mRegistry[me].visibleIndex != WidgetRegistry::npos) {
+		if (c.mRegistry[parent].visibleIndex != WidgetRegistry::npos) {
+			c.moveVisibleRange(me, c.visibleEndOf(parent));
+		} else {
+			c.eraseVisibleRange(me); // new parent is hidden, so are we.
+		}
+	}
+	if (mVisible)
+		c.addVisibleChildren(parent, 1 + c.mRegistry[me].visibleChildren);
+
+	c.mRegistry[me].parent = parent;
+	mParent = p_; // set current widget's new parent
+
+	// if the focus is within our range, our new ancestors contain it now.
+	if (c.mRegistry[me].containsFocus)
+		c.markFocusPath(parent, true);
+
+	// now increase the parents child count by (1+mNumChildren), recursively
+	for (auto a = parent; a != WidgetRegistry::npos; a = c.mRegistry[a].parent) {
+		// travel up parent hierarchy and increase child count for all ancestors
+		c.mRegistry[a].widget->mNumChildren += (1 + mNumChildren);
+	}
+}
+
+// ----------------------------------------------------------------------
+
+void ofxWidget::unparent() {
+	auto & c = context();
+
+	if (c.mRegistry.get(mHandle) != this)
+		return;
+
+	auto me = mHandle.index;
+	auto parent = c.mRegistry[me].parent;
+
+	if (parent == WidgetRegistry::npos)
+		return;
+
+	// ---------| invariant: registered widget which has a parent
+
+	/*
+
+	When an object loses its parent,
+
+	1. decrease ancestors' child count by number of (own children + 1), recursively.
+	2. splice its range out of the parent's range, and to the front of the list.
+	3. clear its parent pointer
+
+	Our children come along with our range, and keep their parent,
+	so in the registry, this is O(depth), no matter how many children 
+	we have. 
+	
+	Our visible range then moves to the back of the visible list, 
+	which is a flat array: that shifts and re-indexes every visible 
+	entry in front of us, which is O(number of visible widgets).
+
+	*/
+
+	// our rect stays where it is on screen - which is now relative 
+	// to nothing. our children's rects don't change at all.
+	mLocalRect.position = getRect().position;
+
+	c.compactVisible(); // visible child counts must not include tombstones.
+
+	// if the focus is within our range, it leaves our old ancestors.
+	if (c.mRegistry[me].containsFocus)
+		c.markFocusPath(parent, false);
+
+	auto first = c.mRegistry[me].first;
+	auto after = c.mRegistry[me].next;
+
+	for (auto a = parent; a != WidgetRegistry::npos; a = c.mRegistry[a].parent) {
+		c.mRegistry[a].widget->mNumChildren -= (mNumChildren + 1);
+		// ancestors which started with our range now start with 
+		// whatever followed our range.
+		if (c.mRegistry[a].first == first)
+			c.mRegistry[a].first = after;
+	}
+
+	if (mVisible)
+		c.addVisibleChildren(parent, -int64_t(1 + c.mRegistry[me].visibleChildren));
+
+	c.mRegistry.unlink(first, me);
+	c.mRegistry.link(first, me, c.mRegistry.front());
+
+	c.mRegistry[me].parent = WidgetRegistry::npos;
+	mParent.reset();
+
+	// top-level widgets have no ancestors to hide them: our visible 
+	// range goes to the back of the visible list, which is its front.
+	if (c.mRegistry[me].visibleIndex != WidgetRegistry::npos) {
+		c.moveVisibleRange(me, c.mVisibleWidgets.size());
+	} else if (mVisible) {
+		c.insertVisibleRange(me, c.mVisibleWidgets.size());
+	}
+}
+
+// ----------------------------------------------------------------------
+
+void ofxWidget::setVisibility(bool visible_) {
+	auto & c = context();
+
+	if (visible_ == mVisible)
+		return;
+
+	mVisible = visible_;
+
+	if (c.mRegistry.get(mHandle) != this)
+		return;
+
+	// ---------| invariant: visibility changed for a registered widget
+
+	auto me = mHandle.index;
+	auto parent = c.mRegistry[me].parent;
+
+	if (parent == WidgetRegistry::npos || c.mRegistry[parent].visibleIndex != WidgetRegistry::npos) {
+		// all our ancestors are visible - which means our range
+		// needs to go into or out of the list of visible widgets.
+		if (mVisible) {
+			c.insertVisibleRange(me, c.visibleInsertPosition(me));
+		} else {
+			c.eraseVisibleRange(me);
+		}
+	}
+
+	auto numWidgets = int64_t(1 + c.mRegistry[me].visibleChildren);
+	c.addVisibleChildren(parent, mVisible ? numWidgets : -numWidgets);
 }
+
 // ----------------------------------------------------------------------
 
-WidgetEventResponder::~WidgetEventResponder()
-{
-	auto listener = this;
-	auto prio = OF_EVENT_ORDER_AFTER_APP;
+void WidgetContext::bringToFront(const ofxWidgetHandle& handle_)
+{
+	if (mRegistry.get(handle_) == nullptr)
+		return;
+
+	// ---------| invariant: element is valid
+
+	// We're conservative with re-ordering.
+	// If the element's range already starts at the beginning of 
+	// the list, there is no need to re-order.
+	if (mRegistry[handle_.index].first == mRegistry.front())
+		return;
+
+	// ----------| invariant: element (range) not yet at front.
+
+	/*
+	Algorithm:
+
+	while current object range has a parent, put current object
+	range to the front of parent range make parent range current
+	object range.
+
+	As soon as there is no parent anymore, put last object range
+	to the front of the list
+
+	Since every slot knows its parent, and the start of its range,
+	this is O(depth) in the registry.
+	*/
 
-	ofRemoveListener(ofEvents().keyReleased, listener, &WidgetEventResponder::keyEvent, prio);
-	ofRemoveListener(ofEvents().keyPressed, listener, &WidgetEventResponder::keyEvent, prio);
+	// Visible ranges move alongside, to the back of the parent's 
+	// visible range, which is where the frontmost children of a parent
+	// are found in mVisibleWidgets. That's a flat array, so this costs
+	// O(depth), plus the entries which actually move - see 
+	// raiseVisibleRanges().
 
-	ofRemoveListener(ofEvents().mouseExited, listener, &WidgetEventResponder::mouseEvent, prio);
-	ofRemoveListener(ofEvents().mouseEntered, listener, &WidgetEventResponder::mouseEvent, prio);
-	ofRemoveListener(ofEvents().mouseScrolled, listener, &WidgetEventResponder::mouseEvent, prio);
-	ofRemoveListener(ofEvents().mouseReleased, listener, &WidgetEventResponder::mouseEvent, prio);
-	ofRemoveListener(ofEvents().mousePressed, listener, &WidgetEventResponder::mouseEvent, prio);
-	ofRemoveListener(ofEvents().mouseMoved, listener, &WidgetEventResponder::mouseEvent, prio);
-	ofRemoveListener(ofEvents().mouseDragged, listener, &WidgetEventResponder::mouseEvent, prio);
+	raiseVisibleRanges(handle_.index);
 
-}
+	auto element = handle_.index;
 
-// ----------------------------------------------------------------------
+	while (mRegistry[element].parent != WidgetRegistry::npos) {
+		// if element has parent, bring element range to front of parent range.
+		auto parent = mRegistry[element].parent;
+		moveRangeToFrontOf(element, parent);
+		element = parent;
+	}
 
-bool WidgetEventResponder::mouseEvent(ofMouseEventArgs & args_)
-{
-	return ofxWidget::mouseEvent(args_);
+	// now move the element range (which is now our most senior parent element range) to the front fo the list.
+
+	moveRangeToFrontOf(element, WidgetRegistry::npos);
 }
 
 // ----------------------------------------------------------------------
 
-bool WidgetEventResponder::keyEvent(ofKeyEventArgs & args_)
-{
-	return ofxWidget::keyEvent(args_);
+void WidgetContext::draw() {
+	int zOrder = 0;
+	bool showDebugView = ofGetKeyPressed(OF_KEY_RIGHT_CONTROL);
+	// we are drawing back to front, which is the order of the frame snapshot.
+	// a callback may destroy widgets - which invalidates their handles, 
+	// so we skip these.
+	WidgetPass pass(*this);
+	ofxWidgetProfiler::Scope profile(*this, ofxWidgetHandle(), ofxWidgetProfiler::DrawPass);
+	bool isOutermost = (mPassDepth == 1); // a nested draw() must not overwrite the culling results of the outer pass
+	bool isClipping = (isOutermost && mNumClippingWidgets > 0);
+	bool isCulling = (isOutermost && bDrawCulling);
+	if (isClipping || isCulling)
+		mFrameCulled.assign(mFrameWidgets.size(), 0);
+	if (isClipping)
+		clipFrameWidgets();
+	if (isCulling)
+		cullFrameWidgets(ofGetCurrentViewport(), isClipping);
+	for (size_t i = 0; i < mFrameWidgets.size(); ++i) {
+		auto p = mFrameWidgets[i];
+		if ((isClipping || isCulling) && mFrameCulled[i])
+			continue;
+		if (p->mHandle.isValid() && p->onDraw) {
+			p->getRect(); // callbacks may hold a reference to the widget rect - make sure it is up to date.
+			{
+				ofxWidgetProfiler::Scope profileWidget(*this, p->mHandle, ofxWidgetProfiler::Draw);
+				p->onDraw(); // call the widget
+			}
+			if (showDebugView) {
+				ofPushStyle();
+				ofFill();
+				ofSetColor(ofColor::red, 64);
+				ofDrawRectangle(p->getRect());
+				ofDrawBitmapStringHighlight(ofToString(zOrder), p->getRect().x, p->getRect().y + 10);
+				ofPopStyle();
+			}
+			zOrder++;
+		}
+	}
 }
 
 // ----------------------------------------------------------------------
-// widgets may only be created through this factory function
-shared_ptr<ofxWidget> ofxWidget::make(const ofRectangle& rect_) {
-	// register for mouse events
-	// this happens only when the first widget gets initialised.
-	static auto onlyResponder = make_shared<WidgetEventResponder>();
 
-	auto widget = shared_ptr<ofxWidget>(new ofxWidget());
-	widget->mRect = rect_;
-	widget->mThis = widget; // widget keeps weak store to self - will this make it leak?
-	// it should not, since we're creating the widget using new(), and not make_shared
+void WidgetContext::update() {
+	// batched input goes first, so that widgets see this frame's 
+	// input in their update callbacks.
+	if (mPassDepth == 0) {
+		dispatchInputQueue();
+		dispatchPostedInput();
+		dispatchTouchQueue();
+	}
 
-	sAllWidgets.emplace_front(widget);  // store a weak pointer to the new object in our list
-	ofxWidget::bVisibleListDirty = true;
-	return std::move(widget);
+	// make sure to update last to first,
+	// just to stay consistent with draw order.
+	WidgetPass pass(*this);
+	ofxWidgetProfiler::Scope profile(*this, ofxWidgetHandle(), ofxWidgetProfiler::UpdatePass);
+	for (auto p : mFrameWidgets) {
+		if (p->mHandle.isValid() && p->onUpdate) {
+			p->getRect(); // callbacks may hold a reference to the widget rect - make sure it is up to date.
+			ofxWidgetProfiler::Scope profileWidget(*this, p->mHandle, ofxWidgetProfiler::Update);
+			p->onUpdate(); // call the widget
+		}
+	}
 }
 
 // ----------------------------------------------------------------------
 
-ofxWidget::ofxWidget() {
+void ofxWidget::update() {
+	WidgetContext::current().update();
 }
 
 // ----------------------------------------------------------------------
 
-ofxWidget::~ofxWidget() {
-
-	// Q: what if the parent gets destroyed first?
+void ofxWidget::draw() {
+	WidgetContext::current().draw();
+}
 
-	// A: We should be fine.
+// ----------------------------------------------------------------------
 
-	// the parent will remove elements from sAllWidgets,
-	// possibly already having deleted our widget.
-	// if that is the case, we can't find ourselves 
-	// in the list of sAllWidgets, and we won't delete
-	// anything from that list.
+ofxWidgetHandle WidgetContext::hitTest(float x_, float y_) {
 
-	auto it = findIt(mThis, sAllWidgets.begin(), sAllWidgets.end());
+	compactVisible();
 
-	if (it != sAllWidgets.end()) {
+	// fast path: nothing has changed since the last hit test, and 
+	// we're still inside the area where its result holds.
+	// (any change to visible widgets changes the version, so a cached
+	// hit is still registered.)
+	if (isCached(mHitCache, x_, y_))
+		return mHitCache.hit;
 
-		// we have found ourselves. now, we need to delete our object range from 
-		// the global list of widgets.
+	ofVec2f point(x_, y_);
+	ofxWidgetHandle hit;
+	hitTest(&point, 1, &hit);
+	updateHitCache(mHitCache, x_, y_, hit);
+	return hit;
+}
 
-		sAllWidgets.erase(std::prev(it, mNumChildren), std::next(it)); // we delete the children, too.
+// ----------------------------------------------------------------------
 
-		// let's see if we have a parent
-		if (auto parent = mParent.lock()) {
-			// decrement the parent's child number by (mNumChildren+1) ...
-			parent->mNumChildren -= (mNumChildren + 1);
-			// ... recursively
-			while (parent = parent->mParent.lock()) {
-				parent->mNumChildren -= (mNumChildren + 1);
-			}
-		};
-		ofxWidget::bVisibleListDirty = true;
-	} // end if (it != sAllWidgets.end()) 
+bool WidgetContext::isCached(const WidgetHitCache& cache_, float x_, float y_) const {
+	return (cache_.visibleWidgetsVersion == mVisibleWidgetsVersion
+		&& cache_.geometryVersion == mGeometryVersion
+		&& cache_.isInside(x_, y_));
 }
 
 // ----------------------------------------------------------------------
 
-void ofxWidget::setParent(std::shared_ptr<ofxWidget>& p_)
-{
-	if (auto p = mParent.lock()) {
-		// TODO: handle already parented widgets 
-		// how weird! this widget has a parent already.
-		// delete the widgets from the parent's child list
-		ofLogWarning() << "Widget already has parent!";
-		return;
+void WidgetContext::updateHitCache(WidgetHitCache& cache_, float x_, float y_, const ofxWidgetHandle& hit_) {
+
+	cache_.visibleWidgetsVersion = uint64_t(-1); // not cached - unless we get to the end.
+
+	// start with the visible part of the widget that was hit - or with
+	// everything, if nothing was hit.
+	float x0 = -std::numeric_limits<float>::max();
+	float y0 = -std::numeric_limits<float>::max();
+	float x1 = std::numeric_limits<float>::max();
+	float y1 = std::numeric_limits<float>::max();
+
+	size_t front = 0; // all visible widgets from here on are in front of the hit
+	
+	if (mRegistry.get(hit_) != nullptr) {
+		auto element = hit_.index;
+		front = mRegistry[element].visibleIndex + 1;
+
+		const auto & rect = mRegistry[element].widget->getRect();
+		x0 = rect.getMinX();
+		y0 = rect.getMinY();
+		x1 = rect.getMaxX();
+		y1 = rect.getMaxY();
+
+		if (mNumClippingWidgets > 0) {
+			for (auto a = mRegistry[element].parent; a != WidgetRegistry::npos; a = mRegistry[a].parent) {
+				auto w = mRegistry[a].widget;
+				if (!w->getClipChildren())
+					continue;
+				const auto & clip = w->getRect();
+				x0 = std::max(x0, clip.getMinX());
+				y0 = std::max(y0, clip.getMinY());
+				x1 = std::min(x1, clip.getMaxX());
+				y1 = std::min(y1, clip.getMaxY());
+			}
+		}
 	}
 
-	// find ourselves in widget list
-	auto itMe = findIt(mThis, sAllWidgets.begin(), sAllWidgets.end());
-	// find parent in widget list
-	weak_ptr<ofxWidget> tmpParent = p_;
-	auto itParent = findIt(tmpParent, sAllWidgets.begin(), sAllWidgets.end());
-
-	/*
-
-	When an object gets a parent,
-
-	1. move it to the beginning of the parent's child range.
-	2. set its parent pointer
-	3. increase parent's child count by number of (own children + 1 ), recursively.
-
-	*/
-
-	if (itParent != sAllWidgets.end()) {
-		// move current element and its children to the front of the new parent's child range
-		if (auto parent = itParent->lock()) {
-
-			sAllWidgets.splice(
-				std::prev(itParent, parent->mNumChildren), 				// where to move elements to -> front of parent range
-				sAllWidgets, 											// where to take elements from
-				std::prev(itMe, mNumChildren), std::next(itMe));		// range of elements to move -> range of current element and its children
-
-			mParent = parent; // set current widget's new parent
-			// now increase the parents child count by (1+mNumChildren), recursively
-
-			parent->mNumChildren += (1 + mNumChildren);
-
-			while (parent = parent->mParent.lock()) {
-				// travel up parent hierarchy and increase child count for all ancestors
-				parent->mNumChildren += (1 + mNumChildren);
+	// cut away the rect of every visible widget in front, which 
+	// overlaps what's left. of the (up to four) ways to cut, keeping 
+	// x_, y_ outside the widget in front, we keep the largest part.
+	// if x_, y_ lies inside a widget in front (which must be clipped 
+	// there then), there is no way to cut, and we don't cache.
+	auto cut = [&](float rx0_, float ry0_, float rx1_, float ry1_) -> bool {
+		if (rx0_ >= x1 || rx1_ <= x0 || ry0_ >= y1 || ry1_ <= y0)
+			return true; // no overlap
+		double best = -1.;
+		int side = -1;
+		auto consider = [&](bool possible_, double area_, int side_) {
+			if (possible_ && area_ > best) {
+				best = area_;
+				side = side_;
+			}
+		};
+		consider(x_ <= rx0_, (double(rx0_) - x0) * (double(y1) - y0), 0);
+		consider(x_ >= rx1_, (double(x1) - rx1_) * (double(y1) - y0), 1);
+		consider(y_ <= ry0_, (double(x1) - x0) * (double(ry0_) - y0), 2);
+		consider(y_ >= ry1_, (double(x1) - x0) * (double(y1) - ry1_), 3);
+		switch (side) {
+		case 0: x1 = rx0_; return true;
+		case 1: x0 = rx1_; return true;
+		case 2: y1 = ry0_; return true;
+		case 3: y0 = ry1_; return true;
+		}
+		return false;
+	};
+
+	if (mHitGrid.bEnabled) {
+		// widgets in front which aren't binned into the grid cell under 
+		// x_, y_ don't overlap that cell - so we stay inside the cell.
+		float cx0, cy0, cx1, cy1;
+		mHitGrid.cellBounds(x_, y_, cx0, cy0, cx1, cy1);
+		x0 = std::max(x0, cx0);
+		y0 = std::max(y0, cy0);
+		x1 = std::min(x1, cx1);
+		y1 = std::min(y1, cy1);
+		bool isCacheable = true;
+		mHitGrid.query(x_, y_, [&](uint32_t s) {
+			auto & slot = mRegistry[s];
+			if (!isCacheable || slot.visibleIndex == WidgetRegistry::npos || slot.visibleIndex < front)
+				return;
+			const auto & r = slot.widget->getRect();
+			isCacheable = cut(r.getMinX(), r.getMinY(), r.getMaxX(), r.getMaxY());
+		});
+		if (!isCacheable)
+			return;
+	} else {
+		// a block at a time: only rects which overlap what's left need cutting.
+		auto blockSize = WidgetHitBounds::kBlockSize;
+		for (size_t first = front / blockSize * blockSize; first < mHitBounds.size(); first += blockSize) {
+			auto mask = mHitBounds.overlapMask(first, x0, y0, x1, y1);
+			for (size_t n = 0; mask != 0; ++n, mask >>= 1) {
+				auto i = first + n;
+				if ((mask & 1) == 0 || i < front)
+					continue;
+				if (!cut(mHitBounds.minX(i), mHitBounds.minY(i), mHitBounds.maxX(i), mHitBounds.maxY(i)))
+					return;
 			}
 		}
 	}
 
-	ofxWidget::bVisibleListDirty = true;
+	cache_.hit = hit_;
+	cache_.x0 = x0;
+	cache_.y0 = y0;
+	cache_.x1 = x1;
+	cache_.y1 = y1;
+	cache_.visibleWidgetsVersion = mVisibleWidgetsVersion;
+	cache_.geometryVersion = mGeometryVersion;
 }
 
 // ----------------------------------------------------------------------
 
-void ofxWidget::updateVisibleWidgetsList() {
-
-	if (!ofxWidget::bVisibleListDirty)
+void WidgetContext::hitTest(const ofVec2f* points_, size_t numPoints_, ofxWidgetHandle* hits_) {
+
+	compactVisible();
+
+	std::fill(hits_, hits_ + numPoints_, ofxWidgetHandle());
+
+	if (mHitGrid.bEnabled) {
+		// the grid gives us candidates under each point - 
+		// the topmost visible candidate wins.
+		updateRects();
+		for (size_t p = 0; p < numPoints_; ++p) {
+			auto x = points_[p].x;
+			auto y = points_[p].y;
+			auto topmost = WidgetRegistry::npos;
+			mHitGrid.query(x, y, [this, &topmost, &x, &y](uint32_t s) {
+				auto & slot = mRegistry[s];
+				if (slot.visibleIndex != WidgetRegistry::npos
+					&& (topmost == WidgetRegistry::npos || slot.visibleIndex > topmost)
+					&& slot.widget->getRect().inside(x, y)
+					&& !isClippedAt(s, x, y))
+					topmost = slot.visibleIndex;
+			});
+			if (topmost != WidgetRegistry::npos)
+				hits_[p] = mVisibleWidgets[topmost];
+		}
 		return;
+	}
 
-	//ofLogNotice() << "vList Update cache miss";
-
-	// build a list of visible widgets based on all widgets
-	// TODO: only rebuild this list if visiblility list on adding/removing and 
-	// parenting widgets, and on changing widget visiblity, of course.
-	sVisibleWidgets.clear();
-
-	for (auto it = sAllWidgets.crbegin(); it != sAllWidgets.crend(); ++it) {
-		if (auto p = it->lock()) {
-			if (p->mVisible) {
-				sVisibleWidgets.emplace_front(*it);
+	// hit-test only visible widgets - this makes sure to only evaluate 
+	// the widgets which are visible, and whose parents are visible, too.
+	// we test front to back, one block of rects at a time, and test all
+	// points which haven't hit anything yet against each block, which 
+	// is then still in cache. a point is done with the first (topmost)
+	// rect which contains it, and isn't clipped by an ancestor.
+
+	updateHitBounds();
+
+	static thread_local std::vector<size_t> pending;
+	pending.resize(numPoints_);
+	for (size_t p = 0; p < numPoints_; ++p)
+		pending[p] = p;
+
+	auto numBlocks = (mHitBounds.size() + WidgetHitBounds::kBlockSize - 1) / WidgetHitBounds::kBlockSize;
+
+	for (auto block = numBlocks; block > 0 && !pending.empty(); --block) {
+		auto first = (block - 1) * WidgetHitBounds::kBlockSize;
+		for (size_t k = 0; k < pending.size(); ) {
+			const auto & point = points_[pending[k]];
+			auto mask = mHitBounds.insideMask(first, point.x, point.y);
+			bool isHit = false;
+			for (auto n = WidgetHitBounds::kBlockSize; n > 0 && mask != 0 && !isHit; --n) {
+				if ((mask & (1u << (n - 1))) == 0)
+					continue;
+				auto & h = mVisibleWidgets[first + n - 1];
+				if (!isClippedAt(h.index, point.x, point.y)) {
+					hits_[pending[k]] = h;
+					isHit = true;
+				}
+				mask &= ~(1u << (n - 1));
+			}
+			if (isHit) {
+				pending[k] = pending.back(); // order of pending points doesn't matter
+				pending.pop_back();
 			} else {
-				std::advance(it, p->mNumChildren);
+				++k;
 			}
 		}
 	}
-	ofxWidget::bVisibleListDirty = false;
 }
 
 // ----------------------------------------------------------------------
 
-void ofxWidget::bringToFront(std::list<weak_ptr<ofxWidget>>::iterator it_)
-{
-	if (it_->expired())
+void WidgetContext::dispatchInputQueue() {
+	// callbacks might cause more events to be queued - these 
+	// will have to wait for the next frame.
+	if (mInputQueue.empty())
 		return;
+	std::vector<QueuedInputEvent> queue;
+	std::swap(queue, mInputQueue);
+	for (auto & e : queue) {
+		if (e.isMouseEvent) {
+			mouseEvent(e.mouse);
+		} else {
+			keyEvent(e.key);
+		}
+	}
+}
 
-	// ---------| invariant: element is valid
+// ----------------------------------------------------------------------
 
-	auto element = it_->lock();
+void WidgetContext::dispatchPostedInput() {
+	// bounded: events posted faster than we dispatch them must 
+	// not stall our thread. they'll wait for the next frame.
+	QueuedInputEvent e;
+	for (size_t i = 0; i < mMaxPostedEventsPerFrame && mPostedInput.pop(e); ++i) {
+		if (e.isMouseEvent) {
+			mouseEvent(e.mouse);
+		} else {
+			keyEvent(e.key);
+		}
+	}
+}
 
-	// We're conservative with re-ordering.
-	// Let's move the iterator backward to see if we are actually 
-	// already sorted.
-	// If the list were already sorted, then moving back from the current
-	// iterator by the number of its children would bring us 
-	// to the beginning of sAllWidgets. Then, there is no need to re-order.
-	if (std::prev(it_, element->mNumChildren) == sAllWidgets.begin())
-		return;
+// ----------------------------------------------------------------------
 
-	// ----------| invariant: element (range) not yet at front.
+bool ofxWidget::postMouseEvent(const ofMouseEventArgs& args_) {
+	return ofxWidgetContext::getCurrent().postMouseEvent(args_);
+}
 
-	/*
-	Algorithm:
+// ----------------------------------------------------------------------
 
-	while current object range has a parent, put current object
-	range to the front of parent range make parent range current
-	object range.
+bool ofxWidget::postKeyEvent(const ofKeyEventArgs& args_) {
+	return ofxWidgetContext::getCurrent().postKeyEvent(args_);
+}
 
-	As soon as there is no parent anymore, put last object range
-	to the front of the list
+// ----------------------------------------------------------------------
 
-	Heuristic: parent iterator's position always to be found
-	after current iterator.
-	*/
+void ofxWidget::setMaxPostedEventsPerFrame(size_t maxEvents_) {
+	auto & c = WidgetContext::current();
+	c.mMaxPostedEventsPerFrame = maxEvents_;
+}
 
-	auto parent = element->mParent.lock();
-	auto elementIt = it_;
+// ----------------------------------------------------------------------
 
-	while (parent) {
+void ofxWidget::setInputBatching(bool enabled_) {
+	auto & c = WidgetContext::current();
+	c.bInputBatching = enabled_;
+	if (!c.bInputBatching)
+		c.dispatchInputQueue(); // don't lose any queued events
+}
 
-		auto itParent = findIt(element->mParent, std::next(elementIt), sAllWidgets.end()); // start our search for parent after current element.
+// ----------------------------------------------------------------------
 
-		// if element has parent, bring element range to front of parent range.
-		if (std::prev(elementIt, element->mNumChildren) != std::prev(itParent, parent->mNumChildren)) {
-			sAllWidgets.splice(
-				std::prev(itParent, parent->mNumChildren), 					// where to move elements to -> front of parent range
-				sAllWidgets, 												// where to take elements from
-				std::prev(elementIt, element->mNumChildren),
-				std::next(elementIt));		// range of elements to move -> range of current element and its children
-		}
+void ofxWidget::setDrawCulling(bool enabled_) {
+	auto & c = WidgetContext::current();
+	c.bDrawCulling = enabled_;
+}
 
-		// because sAllWidgets is a list, splice will only invalidate iterators 
-		// before our next search range.
+// ----------------------------------------------------------------------
 
-		elementIt = itParent;
-		element = elementIt->lock();
-		parent = element->mParent.lock();
+void ofxWidget::setClipChildren(bool clip_) {
+	auto & c = context();
+	if (clip_ == mClipChildren)
+		return;
+	mClipChildren = clip_;
+	++c.mGeometryVersion;
+	if (mClipChildren) {
+		++c.mNumClippingWidgets;
+	} else {
+		--c.mNumClippingWidgets;
 	}
+}
 
-	// now move the element range (which is now our most senior parent element range) to the front fo the list.
+// ----------------------------------------------------------------------
 
-	if (std::prev(elementIt, element->mNumChildren) != sAllWidgets.begin()) {
-		sAllWidgets.splice(
-			sAllWidgets.begin(),
-			sAllWidgets,
-			std::prev(elementIt, element->mNumChildren), // from the beginning of our now most senior parent element range
-			std::next(elementIt));						 // to the end of our now most senior parent element range
+ofRectangle ofxWidget::getClippedRect() const {
+	auto & c = context();
+	auto rect = getRect();
+	if (c.mNumClippingWidgets == 0 || c.mRegistry.get(mHandle) != this)
+		return rect;
+	for (auto a = c.mRegistry[mHandle.index].parent; a != WidgetRegistry::npos; a = c.mRegistry[a].parent) {
+		auto w = c.mRegistry[a].widget;
+		if (!w->getClipChildren())
+			continue;
+		if (!w->getRect().intersects(rect))
+			return ofRectangle(rect.x, rect.y, 0, 0);
+		rect = w->getRect().getIntersection(rect);
 	}
+	return rect;
+}
+
+// ----------------------------------------------------------------------
 
-	ofxWidget::bVisibleListDirty = true;
+ofxWidgetHandle ofxWidget::hitTest(const ofVec2f& point_) {
+	return WidgetContext::current().hitTest(point_.x, point_.y);
 }
 
 // ----------------------------------------------------------------------
 
-void ofxWidget::draw() {
-	int zOrder = 0;
-	updateVisibleWidgetsList();
-	// note the reverse iterators: we are drawing back to front.
-	for (auto it = sVisibleWidgets.crbegin(); it != sVisibleWidgets.crend(); ++it) {
-		if (auto p = it->lock()) {
-			if (p->onDraw) {
-				p->onDraw(); // call the widget
-				if (ofGetKeyPressed(OF_KEY_RIGHT_CONTROL)) {
-					ofPushStyle();
-					ofFill();
-					ofSetColor(ofColor::red, 64);
-					ofDrawRectangle(p->getRect());
-					ofDrawBitmapStringHighlight(ofToString(zOrder), p->mRect.x, p->mRect.y + 10);
-					ofPopStyle();
-				}
-				zOrder++;
-			}
-		}
-	}
+void ofxWidget::hitTest(const std::vector<ofVec2f>& points_, std::vector<ofxWidgetHandle>& hits_) {
+	hits_.resize(points_.size());
+	if (!points_.empty())
+		WidgetContext::current().hitTest(points_.data(), points_.size(), hits_.data());
 }
 
 // ----------------------------------------------------------------------
 
-void ofxWidget::update() {
-	updateVisibleWidgetsList();
-	// make sure to update last to first,
-	// just to stay consistent with draw order.
-	for (auto it = sVisibleWidgets.crbegin(); it != sVisibleWidgets.crend(); ++it) {
-		if (auto p = it->lock()) {
-			if (p->onUpdate)
-				p->onUpdate(); // call the widget
-		}
+void ofxWidget::setHitTestGrid(bool enabled_, float cellSize_) {
+	auto & c = WidgetContext::current();
+	c.updateRects(); // so that nothing gets re-binned while we build the grid
+	c.mHitGrid.clear(cellSize_);
+	c.mHitGrid.bEnabled = enabled_;
+	if (!enabled_)
+		return;
+	for (auto i = c.mRegistry.front(); i != WidgetRegistry::npos; i = c.mRegistry[i].next) {
+		c.mHitGrid.insert(i, c.mRegistry[i].widget->getRect());
 	}
 }
 
 // ----------------------------------------------------------------------
-// static method - called once for all widgets by the
-//                 WidgetEventResponder, which self-
-//                 registers to all events upon creation of the first widget.
+// called once for all widgets of this context by its
+// WidgetEventResponder, or when batched or posted events 
+// get dispatched.
 //
-bool ofxWidget::mouseEvent(ofMouseEventArgs& args_) {
+bool WidgetContext::mouseEvent(ofMouseEventArgs& args_) {
+	// callbacks which make widgets make them in this context.
+	ofxWidgetContext::Scope scope(*this);
+
 	// If we register a mouse down event, we do a hit test over
 	// all visible widgets, and re-order if necessary.
 	// Then, and in all other cases, we do a hit-test on the 
 	// frontmost widget and, if positive, forward the event to this 
 	// widget.
 
-	updateVisibleWidgetsList();
+	float mx = args_.x;
+	float my = args_.y;
+
+	// a widget which captured the pointer gets all events, wherever 
+	// the mouse goes - no hit-test, no focus or hover changes. 
+	if (auto w = fromHandle(mCapturedWidget)) {
+		bool eventAttended = notify(w, ofxWidgetProfiler::Mouse, w->onMouse, args_);
+		if (args_.type == ofMouseEventArgs::Released) {
+			mCapturedWidget = ofxWidgetHandle();
+			// hover was frozen during the capture - catch up.
+			if (!mVisibleWidgets.empty())
+				updateHover(hitTest(mx, my));
+		}
+		mLastMousePos.set(mx, my);
+		return eventAttended;
+	}
 
-	if (sVisibleWidgets.empty()) return false;
+	if (mVisibleWidgets.empty()) return false;
 
 	// ---------| invariant: there are some widgets flying around.
 
 	bool eventAttended = false;
 
-	float mx = args_.x;
-	float my = args_.y;
-
 	// if we have a mouse down on a widget, we need to check which 
 	// widget was hit and potentially re-order widgets.
 
 	// find the first widget that is under the mouse, that is also visible
 	// if it is not yet up front, bring it to the front.
 
-	// hit-test only visible widgets - this makes sure to only evaluate 
-	// the widgets which are visible, and whose parents are visible, too.
-	auto itUnderMouse = std::find_if(sVisibleWidgets.begin(), sVisibleWidgets.end(), [&mx, &my](std::weak_ptr<ofxWidget>& w) ->bool {
-		auto p = w.lock();
-		if (p && p->mVisible && p->mRect.inside(mx, my)) {
-			return true;
-		} else {
-			return false;
-		}
-	});
+	auto underMouse = hitTest(mx, my);
 
 	// if we have a click, we want to make sure the widget gets to be the topmost widget.
 	if (args_.type == ofMouseEventArgs::Pressed) {
+		press(underMouse);
+	}
 
-		// --- now iterate over sAllWidgets instead of just the visible widgets.
-		// we need to do this, because otherwise the reorder check won't be safe 
-		// as the number of children in sVisibleWidgets is potentially incorrect,
-		// as the number of children there refers to all children of a widget,
-		// and not just the visible children of the widget.
-		auto itPressedWidget = (itUnderMouse == sVisibleWidgets.end() ?
-			sAllWidgets.end() :
-			findIt(*itUnderMouse, sAllWidgets.begin(), sAllWidgets.end()));
-
-		if (itPressedWidget != sAllWidgets.end()) {
-			if (!isSame(*itPressedWidget, sFocusedWidget)) {
-				// change in focus detected.
-				// first, let the first element know that it is losing focus
-				if (auto previousElementInFocus = sFocusedWidget.lock())
-					if (previousElementInFocus->onFocusLeave)
-						previousElementInFocus->onFocusLeave();
-
-				sFocusedWidget = *itPressedWidget;
-
-				// now that the new wiget is at the front, send an activate callback.
-				if (auto nextFocusedWidget = sFocusedWidget.lock())
-					if (nextFocusedWidget->onFocusEnter)
-						nextFocusedWidget->onFocusEnter();
-			}
-			bringToFront(itPressedWidget); // reorder widgets
-		} else {
-			// hit test was not successful, no wigets found.
-			if (auto previousElementInFocus = sFocusedWidget.lock())
-				if (previousElementInFocus->onFocusLeave)
-					previousElementInFocus->onFocusLeave();
+	// now, we will attempt to send the mouse event to the widget that 
+	// is in focus.
+
+	updateHover(underMouse);
+
+	if (auto w = fromHandle(mFocusedWidget)) {
+		eventAttended = notify(w, ofxWidgetProfiler::Mouse, w->onMouse, args_);
+	}
 
-			sFocusedWidget.reset(); // no widget gets the focus, then.
+	// store last mouse position last thing, so that 
+	// we are able to calculate a difference.
+	mLastMousePos.set(mx, my);
+	return eventAttended;
+}
+
+// ----------------------------------------------------------------------
+
+void WidgetContext::press(const ofxWidgetHandle& pressed_) {
+	// --- now reorder using the widget's registry slot instead of just the visible widgets.
+	// we need to do this, because otherwise the reorder check won't be safe 
+	// as the number of children in mVisibleWidgets is potentially incorrect,
+	// as the number of children there refers to all children of a widget,
+	// and not just the visible children of the widget.
+	if (mRegistry.get(pressed_)) {
+		if (!isSame(pressed_, mFocusedWidget)) {
+			// change in focus detected.
+			// first, let the first element know that it is losing focus
+			if (auto previousElementInFocus = fromHandle(mFocusedWidget))
+				notify(previousElementInFocus, ofxWidgetProfiler::FocusLeave, previousElementInFocus->onFocusLeave);
+
+			setFocusedWidget(pressed_);
+
+			// now that the new wiget is at the front, send an activate callback.
+			if (auto nextFocusedWidget = fromHandle(mFocusedWidget))
+				notify(nextFocusedWidget, ofxWidgetProfiler::FocusEnter, nextFocusedWidget->onFocusEnter);
 		}
-	} // end if (args_.type == ofMouseEventArgs::Pressed)
+		bringToFront(pressed_); // reorder widgets - this is a no-op if callbacks destroyed the widget
+	} else {
+		// hit test was not successful, no wigets found.
+		if (auto previousElementInFocus = fromHandle(mFocusedWidget))
+			notify(previousElementInFocus, ofxWidgetProfiler::FocusLeave, previousElementInFocus->onFocusLeave);
 
-	// now, we will attempt to send the mouse event to the widget that 
-	// is in focus.
+		setFocusedWidget(ofxWidgetHandle()); // no widget gets the focus, then.
+	}
+}
 
-	if (itUnderMouse != sVisibleWidgets.end()) {
+// ----------------------------------------------------------------------
+
+void WidgetContext::updateHover(const ofxWidgetHandle& underMouse_) {
+	if (underMouse_.isValid()) {
 			// a widget is under the mouse.
 			// is it the same as the current widget under the mouse?
-		if (!isSame(*itUnderMouse, sWidgetUnderMouse)) {
-			if (auto nU = itUnderMouse->lock())
+		if (!isSame(underMouse_, mWidgetUnderMouse)) {
+			if (auto nU = fromHandle(underMouse_))
 			{
 				// there is a new widget under the mouse
-				if (auto w = sWidgetUnderMouse.lock()) {
+				if (auto w = fromHandle(mWidgetUnderMouse)) {
 					// there was an old widget under the mouse
-					if (w->onMouseLeave)
-						w->onMouseLeave();
+					notify(w, ofxWidgetProfiler::MouseLeave, w->onMouseLeave);
 					w->mHover = false;
 				}
-				if (nU->onMouseEnter)
-					nU->onMouseEnter();
+				notify(nU, ofxWidgetProfiler::MouseEnter, nU->onMouseEnter);
 				nU->mHover = true;
-				sWidgetUnderMouse = *itUnderMouse;
+				mWidgetUnderMouse = underMouse_;
 			}
 		}
 	} else {
-		if (auto w = sWidgetUnderMouse.lock()) {
+		if (auto w = fromHandle(mWidgetUnderMouse)) {
 			// there was a widget under mouse,
 			// but now there is none.
-			if (w->onMouseLeave)
-				w->onMouseLeave();
+			notify(w, ofxWidgetProfiler::MouseLeave, w->onMouseLeave);
 			w->mHover = false;
-			sWidgetUnderMouse.reset();
 		}
+		mWidgetUnderMouse = ofxWidgetHandle();
 	}
+}
+
+// ----------------------------------------------------------------------
 
-	if (auto w = sFocusedWidget.lock()) {
-		if (w->onMouse) {
-			w->onMouse(args_);
-			eventAttended = true;
+void WidgetContext::queueTouchEvent(const ofTouchEventArgs& args_) {
+	// a move replaces the last queued move of the same touch, as long
+	// as nothing else happened to that touch in between. a crowded 
+	// touch table sends many more moves than we draw frames.
+	if (args_.type == ofTouchEventArgs::move) {
+		for (auto it = mTouchQueue.rbegin(); it != mTouchQueue.rend(); ++it) {
+			if (it->id != args_.id)
+				continue;
+			if (it->type == ofTouchEventArgs::move) {
+				*it = args_; // coalesce
+				return;
+			}
+			break;
 		}
 	}
+	mTouchQueue.push_back(args_);
+}
 
-	// store last mouse position last thing, so that 
-	// we are able to calculate a difference.
-	sLastMousePos.set(mx, my);
-	return eventAttended;
+// ----------------------------------------------------------------------
+
+WidgetTouch* WidgetContext::findTouch(int id_) {
+	// there are only ever a few dozen touches down at once.
+	for (auto & t : mTouches) {
+		if (t.id == id_)
+			return &t;
+	}
+	return nullptr;
+}
+
+// ----------------------------------------------------------------------
+
+void WidgetContext::updateTouchOver(WidgetTouch& touch_, const ofxWidgetHandle& over_) {
+	if (touch_.over == over_)
+		return;
+	if (auto w = mRegistry.get(touch_.over))
+		--w->mNumTouches;
+	touch_.over = over_;
+	if (auto w = mRegistry.get(touch_.over))
+		++w->mNumTouches;
+}
+
+// ----------------------------------------------------------------------
+
+void WidgetContext::dispatchTouchQueue() {
+	if (mTouchQueue.empty())
+		return;
+
+	// callbacks which make widgets make them in this context.
+	ofxWidgetContext::Scope scope(*this);
+
+	// callbacks might cause more events to be queued - these 
+	// will have to wait for the next frame.
+	std::vector<ofTouchEventArgs> queue;
+	std::swap(queue, mTouchQueue);
+
+	// all touches which need a hit test get hit-tested together, in 
+	// batches. a batch runs up to (and including) the next touch down, 
+	// because a touch down raises the widget it lands on. should any 
+	// callback change z-order, visibility or geometry anyway, the rest 
+	// of the queue is tested again, so that each touch sees the widgets 
+	// as they are when its event is dispatched.
+	//
+	// just like the mouse, each touch caches its last hit, together 
+	// with the area around it in which the hit holds: moves within 
+	// that area skip the batch.
+	std::vector<ofxWidgetHandle> hits(queue.size());
+	std::vector<uint8_t> isTested(queue.size(), 0);
+	std::vector<ofVec2f> points;
+	std::vector<size_t> pointEvents;
+	uint64_t testedVisibleWidgetsVersion = mVisibleWidgetsVersion;
+	uint64_t testedGeometryVersion = mGeometryVersion;
+
+	auto needsHitTest = [this](const ofTouchEventArgs& e_) {
+		if (e_.type == ofTouchEventArgs::move) {
+			auto touch = findTouch(e_.id);
+			return (touch && !touch->bCaptured);
+		}
+		return (e_.type == ofTouchEventArgs::down || e_.type == ofTouchEventArgs::doubleTap);
+	};
+
+	for (size_t i = 0; i < queue.size(); ++i) {
+		if (needsHitTest(queue[i]) && (!isTested[i]
+			|| testedVisibleWidgetsVersion != mVisibleWidgetsVersion
+			|| testedGeometryVersion != mGeometryVersion)) {
+			compactVisible(); // before we trust any cached hits
+			points.clear();
+			pointEvents.clear();
+			std::fill(isTested.begin() + i, isTested.end(), 0);
+			for (auto j = i; j < queue.size(); ++j) {
+				auto & e = queue[j];
+				if (needsHitTest(e)) {
+					auto touch = findTouch(e.id);
+					if (touch && isCached(touch->hitCache, e.x, e.y)) {
+						hits[j] = touch->hitCache.hit;
+					} else {
+						points.push_back(e);
+						pointEvents.push_back(j);
+					}
+					isTested[j] = 1;
+				}
+				if (e.type == ofTouchEventArgs::down)
+					break;
+			}
+			std::vector<ofxWidgetHandle> pointHits(points.size());
+			hitTest(points.data(), points.size(), pointHits.data());
+			for (size_t k = 0; k < points.size(); ++k) {
+				auto & e = queue[pointEvents[k]];
+				hits[pointEvents[k]] = pointHits[k];
+				if (auto touch = findTouch(e.id))
+					updateHitCache(touch->hitCache, e.x, e.y, pointHits[k]);
+			}
+			// the hit test compacts the visible list - which may 
+			// change its version - so we read versions after it.
+			testedVisibleWidgetsVersion = mVisibleWidgetsVersion;
+			testedGeometryVersion = mGeometryVersion;
+		}
+		dispatchTouchEvent(queue[i], hits[i]);
+	}
+}
+
+// ----------------------------------------------------------------------
+
+void WidgetContext::dispatchTouchEvent(ofTouchEventArgs& args_, const ofxWidgetHandle& hit_) {
+	// callbacks may capture the touch - and callbacks may dispatch
+	// touches themselves, by calling update(), so we never hold on to 
+	// a touch across callbacks, but look it up again.
+	auto previousTouch = mDispatchingTouch;
+	mDispatchingTouch = args_.id;
+
+	auto deliver = [this, &args_]() {
+		if (auto touch = findTouch(args_.id))
+			if (auto w = fromHandle(touch->target))
+				notify(w, ofxWidgetProfiler::Touch, w->onTouch, args_);
+	};
+
+	switch (args_.type) {
+	case ofTouchEventArgs::down:
+		if (auto touch = findTouch(args_.id)) {
+			// we missed this touch going up - forget about it.
+			updateTouchOver(*touch, ofxWidgetHandle());
+			*touch = mTouches.back();
+			mTouches.pop_back();
+		}
+		mTouches.push_back({ args_.id, hit_, ofxWidgetHandle(), false, WidgetHitCache() });
+		updateTouchOver(mTouches.back(), hit_);
+		// a touch down is a click, as far as focus and z-order go.
+		press(hit_);
+		deliver();
+		break;
+	case ofTouchEventArgs::move:
+		if (auto touch = findTouch(args_.id)) {
+			if (!touch->bCaptured)
+				updateTouchOver(*touch, hit_);
+			deliver();
+		}
+		break;
+	case ofTouchEventArgs::up:
+	case ofTouchEventArgs::cancel:
+		deliver();
+		if (auto touch = findTouch(args_.id)) {
+			updateTouchOver(*touch, ofxWidgetHandle());
+			*touch = mTouches.back();
+			mTouches.pop_back();
+		}
+		break;
+	case ofTouchEventArgs::doubleTap:
+		if (findTouch(args_.id)) {
+			deliver();
+		} else if (auto w = fromHandle(hit_)) {
+			notify(w, ofxWidgetProfiler::Touch, w->onTouch, args_);
+		}
+		break;
+	default:
+		break;
+	}
+
+	mDispatchingTouch = previousTouch;
 }
 
 // ----------------------------------------------------------------------
 // static method - called once on the widget having the focus
-bool ofxWidget::keyEvent(ofKeyEventArgs& args_) {
+bool WidgetContext::keyEvent(ofKeyEventArgs& args_) {
+	ofxWidgetContext::Scope scope(*this);
 
-	if (sAllWidgets.empty()) return false;
+	if (mRegistry.front() == WidgetRegistry::npos) return false;
 
-	if (auto w = sFocusedWidget.lock()) {
-		if (w->onKey)
-			w->onKey(args_);
+	if (auto w = fromHandle(mFocusedWidget)) {
+		notify(w, ofxWidgetProfiler::Key, w->onKey, args_);
 	}
 	return false;
 }
@@ -507,50 +2903,81 @@ bool ofxWidget::keyEvent(ofKeyEventArgs& args_) {
 // ----------------------------------------------------------------------
 
 void ofxWidget::setFocus(bool focus_) {
+	auto & c = context();
 
 	if (focus_ == isActivated())
 		return;
 
 	// callback previous widget telling it that it 
 	// loses focus
-	if (auto previousElementInFocus = sFocusedWidget.lock())
-		if (previousElementInFocus->onFocusLeave)
-			previousElementInFocus->onFocusLeave();
+	if (auto previousElementInFocus = c.fromHandle(c.mFocusedWidget))
+		notify(previousElementInFocus, ofxWidgetProfiler::FocusLeave, previousElementInFocus->onFocusLeave);
 
-	sFocusedWidget = mThis;
+	c.setFocusedWidget(focus_ ? mHandle : ofxWidgetHandle());
 
 	// callback this widget telling it that it 
 	// receives focus
-	if (auto nextFocusedWidget = sFocusedWidget.lock())
-		if (nextFocusedWidget->onFocusEnter)
-			nextFocusedWidget->onFocusEnter();
+	if (auto nextFocusedWidget = c.fromHandle(c.mFocusedWidget))
+		notify(nextFocusedWidget, ofxWidgetProfiler::FocusEnter, nextFocusedWidget->onFocusEnter);
+}
+
+// ----------------------------------------------------------------------
+
+void ofxWidget::bringToFront() {
+	context().bringToFront(mHandle);
 }
 
 // ----------------------------------------------------------------------
 
 const bool ofxWidget::isAtFront() const {
-	if (sAllWidgets.empty())
+	auto & c = context();
+	if (c.mRegistry.get(mHandle) != this)
 		return false;
-	auto it = findIt(mThis, sAllWidgets.begin(), sAllWidgets.end());
-	return (std::prev(it, mNumChildren) == sAllWidgets.begin());
+	return (c.mRegistry[mHandle.index].first == c.mRegistry.front());
 }
 
 // ----------------------------------------------------------------------
 
 const bool ofxWidget::isActivated() const {
-	return (sAllWidgets.empty()) ? false : isSame(mThis, sFocusedWidget);
+	auto & c = context();
+	return c.isSame(mHandle, c.mFocusedWidget);
 }
 
 // ----------------------------------------------------------------------
 
-const bool ofxWidget::containsFocus() const {
-	if (isSame(sFocusedWidget, mThis))
-		return true;
+void ofxWidget::capturePointer() {
+	auto & c = context();
+	if (c.mRegistry.get(mHandle) != this)
+		return;
+	// from within a touch callback, we capture that touch.
+	if (auto touch = (c.mDispatchingTouch != -1 ? c.findTouch(c.mDispatchingTouch) : nullptr)) {
+		touch->target = mHandle;
+		touch->bCaptured = true;
+	} else {
+		c.mCapturedWidget = mHandle;
+	}
+}
+
+// ----------------------------------------------------------------------
 
-	auto itThis = findIt(mThis, sAllWidgets.begin(), sAllWidgets.end());
+void ofxWidget::releasePointer() {
+	auto & c = context();
+	if (c.isSame(mHandle, c.mCapturedWidget))
+		c.mCapturedWidget = ofxWidgetHandle();
+	for (auto & t : c.mTouches) {
+		if (t.target == mHandle)
+			t.bCaptured = false;
+	}
+}
+
+// ----------------------------------------------------------------------
 
-	for (int i = 0; i != mNumChildren; ++i) {
-		if (isSame(sFocusedWidget, *--itThis))
+const bool ofxWidget::hasPointerCapture() const {
+	auto & c = context();
+	if (c.isSame(mHandle, c.mCapturedWidget))
+		return true;
+	for (auto & t : c.mTouches) {
+		if (t.bCaptured && c.isSame(mHandle, t.target))
 			return true;
 	}
 	return false;
@@ -558,29 +2985,94 @@ const bool ofxWidget::containsFocus() const {
 
 // ----------------------------------------------------------------------
 
-void ofxWidget::moveBy(const ofVec2f & delta_) {
+const bool ofxWidget::containsFocus() const {
+	auto & c = context();
+	// the focus path is kept up to date whenever the focus changes,
+	// or a widget on the path moves or goes away.
+	return (c.mRegistry.get(mHandle) == this && c.mRegistry[mHandle.index].containsFocus);
+}
+
+// ----------------------------------------------------------------------
+
+void ofxWidget::setRect(const ofRectangle& rect_) {
+	auto & c = context();
+
+	// children stay where they are on screen - 
+	// which means they need to move relative to us.
+	auto delta = rect_.position - getRect().position;
+
+	mLocalRect = rect_;
+	mRect = rect_;
+	++c.mGeometryVersion;
+
+	if (c.mRegistry.get(mHandle) != this)
+		return;
+
+	auto parent = c.mRegistry[mHandle.index].parent;
+	if (parent != WidgetRegistry::npos)
+		mLocalRect.position -= c.mRegistry[parent].widget->getRect().position;
 
-	// find the iterator to the current widget
-	auto it = findIt(mThis, sAllWidgets.begin(), sAllWidgets.end());
-	// convert to a reverse iterator
-	auto rIt = std::reverse_iterator<decltype(it)>(it);
+	c.forEachChild(mHandle.index, [&c, &delta](uint32_t child) {
+		c.mRegistry[child].widget->mLocalRect.position -= delta;
+	});
+	if (c.mHitGrid.bEnabled)
+		c.mHitGrid.update(mHandle.index, mRect);
+	c.updateHitBoundsOf(mHandle.index);
+}
+
+// ----------------------------------------------------------------------
+
+void ofxWidget::setLocalRect(const ofRectangle& rect_) {
+	auto & c = context();
+	auto rect = rect_;
+	if (c.mRegistry.get(mHandle) == this) {
+		auto parent = c.mRegistry[mHandle.index].parent;
+		if (parent != WidgetRegistry::npos)
+			rect.position += c.mRegistry[parent].widget->getRect().position;
+	}
+	setRect(rect);
+}
+
+// ----------------------------------------------------------------------
+
+void ofxWidget::updateRect() const {
+	context().updateRects();
+}
 
-	mRect.position += delta_;
+// ----------------------------------------------------------------------
 
-	// all children (if any) are lined up *before* a parent in sAllWidgets.
-	// we're using a reverse iterator so that we don't get a problem 
-	// at the very physically first element.
-	for (int i = 0; i < int(mNumChildren) && rIt != sAllWidgets.rend(); i++, rIt++) {
-		if (auto w = rIt->lock()) {
-			w->mRect.position += delta_;
+void ofxWidget::moveBy(const ofVec2f & delta_) {
+	auto & c = context();
+
+	// children are positioned relative to us, so they move along 
+	// without us touching them. instead, we remember that our subtree
+	// moved, and its rects get re-calculated lazily - all other rects 
+	// stay as they are.
+
+	mLocalRect.position += delta_;
+	++c.mGeometryVersion;
+
+	if (c.mRegistry.get(mHandle) != this || mNumChildren == 0) {
+		// nobody else depends on our rect. (should an ancestor of ours
+		// have moved, our rect gets re-calculated from scratch anyway.)
+		mRect.position += delta_;
+		if (c.mRegistry.get(mHandle) == this) {
+			if (c.mHitGrid.bEnabled)
+				c.mHitGrid.update(mHandle.index, getRect());
+			c.updateHitBoundsOf(mHandle.index);
 		}
+		return;
 	}
+
+	if (c.mRectsPending.empty() || c.mRectsPending.back() != mHandle)
+		c.mRectsPending.push_back(mHandle);
+	c.bRectsPending = true;
 }
 
 // ----------------------------------------------------------------------
 
 void ofxWidget::moveTo(const ofVec2f& pos_) {
-	moveBy(pos_ - mRect.position);
+	moveBy(pos_ - getRect().position);
 }
 
-// ----------------------------------------------------------------------
+// ----------------------------------------------------------------------
\ No newline at end of file
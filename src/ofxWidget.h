@@ -1,8 +1,12 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <memory>
+#include <vector>
 #include "ofEvents.h"
 #include "ofRectangle.h"
+#include "ofxWidgetCallback.h"
 /*
    _____    ___
   /    /   /  /     ofxWidget
@@ -34,25 +38,138 @@ THE SOFTWARE.
 // ----------------------------------------------------------------------
 
 class ofxWidget;
+class WidgetContext;
+
+// ----------------------------------------------------------------------
+
+struct ofxWidgetHandle {
+
+	/*
+
+	A handle addresses a widget slot in the widget registry.
+
+	Slots are re-used once their widget has been destroyed, 
+	but every re-use bumps the slot's generation. This means 
+	a stale handle will never resolve to whichever widget 
+	happens to live in its old slot now.
+
+	*/
+
+	uint32_t index      = uint32_t(-1);
+	uint32_t generation = 0;
+
+	ofxWidgetHandle() = default;
+	ofxWidgetHandle(uint32_t index_, uint32_t generation_)
+		: index(index_)
+		, generation(generation_) {
+	}
+
+	bool isValid() const {
+		return index != uint32_t(-1);
+	}
+	bool operator==(const ofxWidgetHandle& rhs_) const {
+		return index == rhs_.index && generation == rhs_.generation;
+	}
+	bool operator!=(const ofxWidgetHandle& rhs_) const {
+		return !(*this == rhs_);
+	}
+};
+
+// ----------------------------------------------------------------------
+
+class ofxWidgetContext {
+
+	/*
+
+	A widget context owns a complete, independent widget scene: 
+	its widgets and their z-order, the focus, the widget under the 
+	mouse, touches which are down, input queues, and settings such as 
+	the hit test grid.
+
+	Static ofxWidget methods (make(), update(), draw(), ...) act on 
+	the current context of the calling thread. Unless told otherwise, 
+	this is the default context, which starts listening to ofEvents() 
+	once its first widget is made. Use a Scope to make another context 
+	current - for a second window, say, or an offscreen UI layer.
+
+	Widgets stay in the context they were made in, and can only be
+	parented to widgets of the same context. A context must outlive 
+	its widgets.
+
+	Contexts don't share any widget state, so separate contexts may 
+	be used from separate threads - as long as each context is only 
+	used by one thread at a time. The profiler is shared by all 
+	contexts, and locks while it records - see ofxWidgetProfiler.
+
+	*/
+
+	friend class ofxWidget;
+
+protected:
+
+	bool bRectsPending = false;	// whether widgets with children have moved, and their subtrees' rects are out of date
+	uint64_t mId;				// unique among all contexts, for as long as the app runs
+
+	ofxWidgetContext();
+
+public:
+
+	virtual ~ofxWidgetContext() = default;
+
+	ofxWidgetContext(const ofxWidgetContext&) = delete;
+	ofxWidgetContext& operator=(const ofxWidgetContext&) = delete;
+
+	static std::shared_ptr<ofxWidgetContext> make(); //< Create a new, empty context. It won't receive any events until you call listenTo().
+	static ofxWidgetContext& getDefault();	//< The default context, which lives as long as the app does.
+	static ofxWidgetContext& getCurrent();	//< The context static ofxWidget methods act on, for the calling thread.
+
+	uint64_t getId() const;	//< Unique id of this context. Ids count up from 1, and are never re-used, even once a context is destroyed.
+
+	void listenTo(ofCoreEvents& events_);	//< Dispatch mouse, touch and key events from events_ (e.g. a window's events()) to this context's widgets.
+	void stopListening();					//< Stop dispatching events from whichever events this context listened to.
+
+	void update();	//< Trigger update callbacks for all widgets of this context. See ofxWidget::update().
+	void draw();	//< Trigger draw callbacks for all widgets of this context. See ofxWidget::draw().
+
+	bool postMouseEvent(const ofMouseEventArgs& args_); //< Thread-safe, lock-free: queue a synthetic mouse event for this context. See ofxWidget::postMouseEvent().
+	bool postKeyEvent(const ofKeyEventArgs& args_);     //< Thread-safe, lock-free: queue a synthetic key event for this context. See ofxWidget::postKeyEvent().
+
+	class Scope {
+		// makes a context current for the calling thread, 
+		// until the scope ends.
+		ofxWidgetContext* mPrevious;
+	public:
+		Scope(ofxWidgetContext& context_);
+		~Scope();
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+	};
+};
+
+// ----------------------------------------------------------------------
 
 class WidgetEventResponder {
 
 	/*
 	
-	This class is automatically registered 
-	as the sole event responder, once and only once 
-	the first widget is initialised.
+	Each context that listens to events owns one of these.
+	The default context creates its responder once the 
+	first widget is initialised.
 
-	From this class the Widget static member function
-	is called, which will re-distribute the event
+	From this class the context's event handlers are
+	called, which will re-distribute the event
 	to the topmost Widget that has passed the hit test.
 
 	*/
 	bool mouseEvent(ofMouseEventArgs& args);
+	bool touchEvent(ofTouchEventArgs& args);
 	bool keyEvent(ofKeyEventArgs& args);
 
+	WidgetContext& mContext;
+	ofCoreEvents&  mEvents;
+
 public:
-	WidgetEventResponder();
+	WidgetEventResponder(WidgetContext& context_, ofCoreEvents& events_);
 	~WidgetEventResponder();
 };
 
@@ -63,25 +180,29 @@ class ofxWidget
 	// we keep track of all widget rectangles.
 	// everytime a new widget is created or destroyed,
 	// we update our widgetRects.
-	friend class WidgetEventResponder;
+	friend class WidgetContext;
 
-	static bool mouseEvent(ofMouseEventArgs& args);
-	static bool keyEvent(ofKeyEventArgs& args);
-	static void bringToFront(std::list<weak_ptr<ofxWidget>>::iterator it_);
-	static void updateVisibleWidgetsList();
-	static bool bVisibleListDirty;
+	ofxWidget();
+	static void release(ofxWidget* w_); // deleter for widget shared_ptrs
+	void unregister();					// remove this widget (and its children) from the widget registry
+	void updateRect() const;			// re-calculate cached rects on screen of all subtrees which have moved
 
-	static ofVec2f sLastMousePos;
+	ofRectangle mLocalRect;				// widget rect, with position relative to parent widget
+	mutable ofRectangle mRect;			// widget rect on screen - cached, valid unless an ancestor has moved since
 
-	ofxWidget();
-	ofRectangle mRect;					// widget rect on screen
+	ofxWidgetContext* mContext = nullptr; // context this widget lives in
+	WidgetContext& context() const;
 
 	bool mVisible = true;				// layer visiblity
+	bool mOpaque = false;				// whether onDraw covers the whole widget rect
+	bool mClipChildren = false;			// whether children are clipped to this widget's rect
 	bool mHover = false;				// mouse-over detected?
+	uint16_t mNumTouches = 0;			// number of touches over this widget
 
 	size_t mNumChildren = 0;			// number of children for this widget.
 	std::weak_ptr<ofxWidget> mParent;	// parent widget for this.
 	std::weak_ptr<ofxWidget> mThis;		// weak ptr to self
+	ofxWidgetHandle mHandle;			// slot for this widget in the widget registry
 
 public:
 	~ofxWidget();
@@ -89,69 +210,146 @@ public:
 	void setRect(const ofRectangle& rect_); //< set the widget rect in absolute coordinates.
 	const ofRectangle& getRect() const;	    //< return the widget's rect in absolute coordinates.
 
+	void setLocalRect(const ofRectangle& rect_); //< set the widget rect relative to the parent widget's position.
+	const ofRectangle& getLocalRect() const;	 //< return the widget rect relative to the parent widget's position.
+
 	void moveBy(const ofVec2f& delta_); //< Move this widget (and any children) by an offset
 	void moveTo(const ofVec2f& pos_);   //< Move this widget (and any children) to an absolute position
 
 	void setVisibility(bool visible_);	//< Set this widget's visibility. Children of invisible widgets will not be drawn nor updated.
 	const bool getVisibility() const ;  //< Get this widget's visibility
 
-	const bool getHover() const;		//< Return whether the mouse is currently over this widget
+	void setOpaque(bool opaque_);		//< Declare that this widget's onDraw paints its whole rect, so that widgets fully behind it need not be drawn. See setDrawCulling().
+	const bool getOpaque() const;		//< Get whether this widget is declared opaque
 
-	std::function<void(ofMouseEventArgs&)> onMouse; //< Mouse event callback
-	std::function<void(ofKeyEventArgs&)> onKey;		//< Keyboard event callback
-	
-	std::function<void()> onFocusEnter;	//< Activation callback	(when widget receives focus)
-	std::function<void()> onFocusLeave;	//< Deactivation callback (when widget loses focus)
-	std::function<void()> onMouseEnter;	//< Mouse enter callback
-	std::function<void()> onMouseLeave;	//< Mouse exit callback
+	void setClipChildren(bool clip_);	//< Clip children (and their children) to this widget's rect: children only receive hits inside this rect, and children fully outside of it are not drawn.
+	const bool getClipChildren() const;	//< Get whether this widget clips its children
+	ofRectangle getClippedRect() const;	//< Return this widget's rect, clipped by all its ancestors which clip their children. Useful to set a scissor rect in onDraw.
 
-	std::function<void()> onUpdate; //<Once-per frame update callback for widget. Only called if widget is visible.	Update callbacks will be issued based on z-order, back to front.
-	std::function<void()> onDraw;   //<Once-per frame draw callback for widget. Only called if widget is visible. Draw callbacks will be issued over based on z-order, back to front.
+	const bool getHover() const;		//< Return whether the mouse is currently over this widget
+	const size_t getNumTouches() const;	//< Return how many touches are currently over this widget
+
+	// callbacks are ofxWidgetCallbacks: these work like std::function, 
+	// but take just two pointers each, and don't allocate for lambdas 
+	// which capture no more than a pointer.
+	//
+	// onUpdate and onDraw come first, right after mHandle: update and
+	// draw passes test these for every widget, and this way all they 
+	// read sits close together.
+
+	ofxWidgetCallback<void()> onUpdate; //<Once-per frame update callback for widget. Only called if widget is visible.	Update callbacks will be issued based on z-order, back to front.
+	ofxWidgetCallback<void()> onDraw;   //<Once-per frame draw callback for widget. Only called if widget is visible. Draw callbacks will be issued over based on z-order, back to front.
+
+	ofxWidgetCallback<void(ofMouseEventArgs&)> onMouse; //< Mouse event callback
+	ofxWidgetCallback<void(ofKeyEventArgs&)> onKey;		//< Keyboard event callback
+	ofxWidgetCallback<void(ofTouchEventArgs&)> onTouch;	//< Touch event callback - for all events of each touch which went down on this widget
+	
+	ofxWidgetCallback<void()> onFocusEnter;	//< Activation callback	(when widget receives focus)
+	ofxWidgetCallback<void()> onFocusLeave;	//< Deactivation callback (when widget loses focus)
+	ofxWidgetCallback<void()> onMouseEnter;	//< Mouse enter callback
+	ofxWidgetCallback<void()> onMouseLeave;	//< Mouse exit callback
 	
-	void setParent(std::shared_ptr<ofxWidget>& p_); //< set a widget's parent, this will update the children list, by calling a method over all widgets.
+	void setParent(std::shared_ptr<ofxWidget>& p_); //< set a widget's parent - if the widget has a parent already, it moves over to p_, together with all its children.
+	void unparent();								//< detach a widget (and its children) from its parent, and make it a top-level widget at the front.
 	std::weak_ptr<ofxWidget>& getParent();
 
+	const ofxWidgetHandle& getHandle() const;	//< registry handle for this widget. Invalid once the widget (or one of its ancestors) has been destroyed.
+	static std::shared_ptr<ofxWidget> fromHandle(const ofxWidgetHandle& handle_); //< return the widget addressed by handle_ in the current context, or nullptr if handle_ is stale.
+
+	ofxWidgetContext& getContext() const;		//< the context this widget lives in
+
+	// these act on the current context - see ofxWidgetContext.
+
 	static void update();		//< Trigger update callbacks for all widgets. The callbacks will be issued in the correct z-order, back to front.
 	static void draw();			//< Trigger draw callbacks for all widgets. The callbacks will be issued in the correct z-order, back to front.
+
+	static void setHitTestGrid(bool enabled_, float cellSize_ = 64.f); //< Accelerate mouse hit-testing using a uniform grid over all widget rects. Worth it for UIs with many widgets.
+	static ofxWidgetHandle hitTest(const ofVec2f& point_); //< Return the topmost visible widget at point_ in the current context - or an invalid handle, if there is none.
+	static void hitTest(const std::vector<ofVec2f>& points_, std::vector<ofxWidgetHandle>& hits_); //< Hit-test many points (touches, pointers) in one go: hits_[i] is the topmost visible widget at points_[i].
+	static bool postMouseEvent(const ofMouseEventArgs& args_); //< Thread-safe, lock-free: queue a synthetic mouse event, to be dispatched from within update(). Returns false if the queue is full.
+	static bool postKeyEvent(const ofKeyEventArgs& args_);     //< Thread-safe, lock-free: queue a synthetic key event, to be dispatched from within update(). Returns false if the queue is full.
+	static void setMaxPostedEventsPerFrame(size_t maxEvents_);  //< Limit how many posted events update() dispatches per frame - any others wait for the next frame.
+	static void setInputBatching(bool enabled_); //< Queue mouse and key events, and dispatch them once per frame, from within update(). Consecutive mouse moves (and drags) are coalesced. Off by default.
+	static void setDrawCulling(bool enabled_); //< Skip draw callbacks for widgets outside the current viewport, and for widgets fully covered by an opaque widget in front of them. Off by default.
 	
 
 public: // widget logic functions
 
 	void setFocus(bool focus_);	 // manually give widget focus
+	void bringToFront();		 //< manually bring widget (and its ancestors) to the front
 
 	const bool isAtFront() const;		//< returns whether this widget as far to the front as possible
 	const bool isActivated() const;		//< returns whether this widget has the focus
-	const bool containsFocus() const;	//< returns whether this widget or one of its children the focus
+	const bool containsFocus() const;	//< returns whether this widget or one of its children has the focus
+
+	void capturePointer();					//< Send all mouse events straight to this widget - skipping hit-tests and hover changes - until the next mouse release. Call it from onMouse on Pressed, to follow a drag. Called from onTouch, this captures the touch instead, until it is lifted.
+	void releasePointer();					//< Give up pointer capture (of the mouse, and of any touches) before the pointer is released.
+	const bool hasPointerCapture() const;	//< returns whether this widget has captured the mouse, or any touch
 public: // factory function
-	static shared_ptr<ofxWidget> make(const ofRectangle& rect_);
+	static shared_ptr<ofxWidget> make(const ofRectangle& rect_); //< make a widget in the current context
+
+	// Create a whole widget subtree in one go - this is much faster than 
+	// make() plus setParent() for each widget. parents_[i] is the index 
+	// of widget i's parent within rects_, which must come before widget i,
+	// or -1 for widgets at the top of the subtree. These become children 
+	// of parent_, if given. Returns widgets in the order of rects_, or 
+	// an empty vector if the description was invalid. Widgets are made 
+	// in parent_'s context, if given, and in the current context if not.
+	static std::vector<shared_ptr<ofxWidget>> makeTree(const std::vector<ofRectangle>& rects_, const std::vector<int>& parents_, const std::shared_ptr<ofxWidget>& parent_ = nullptr);
 };
 
 // ----------------------------------------------------------------------
  
+inline uint64_t ofxWidgetContext::getId() const {
+	return mId;
+}
+
+// ----------------------------------------------------------------------
+ 
 inline std::weak_ptr<ofxWidget>& ofxWidget::getParent() {
 		return mParent;
 };
 
+inline const ofxWidgetHandle& ofxWidget::getHandle() const {
+	return mHandle;
+}
+
+inline ofxWidgetContext& ofxWidget::getContext() const {
+	return *mContext;
+}
+
 inline const bool ofxWidget::getHover() const {
 	return mHover;
 }
 
+inline const size_t ofxWidget::getNumTouches() const {
+	return mNumTouches;
+}
+
 inline const bool ofxWidget::getVisibility() const {
 	return mVisible;
 };
 
-inline void ofxWidget::setVisibility(bool visible_) {
-	if (visible_ != mVisible)
-		bVisibleListDirty = true;
-	mVisible = visible_;
+inline void ofxWidget::setOpaque(bool opaque_) {
+	mOpaque = opaque_;
 };
 
-inline void ofxWidget::setRect(const ofRectangle& rect_) {
-	mRect = rect_;
-}
+inline const bool ofxWidget::getOpaque() const {
+	return mOpaque;
+};
+
+inline const bool ofxWidget::getClipChildren() const {
+	return mClipChildren;
+};
 
 inline const ofRectangle& ofxWidget::getRect() const {
+	if (mContext->bRectsPending)
+		updateRect();
 	return mRect;
 };
 
+inline const ofRectangle& ofxWidget::getLocalRect() const {
+	return mLocalRect;
+};
+
 // ----------------------------------------------------------------------
@@ -0,0 +1,216 @@
+#pragma once
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+/*
+   _____    ___
+  /    /   /  /     ofxWidget
+ /  __/ * /  /__    (c) ponies & light ltd., 2015-2016.
+/__/     /_____/    poniesandlight.co.uk
+
+ofxWidget
+Created by @tgfrerer 2015.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+// ----------------------------------------------------------------------
+
+template<typename Signature>
+class ofxWidgetCallback;
+
+template<typename R, typename ... Args>
+class ofxWidgetCallback<R(Args...)> {
+
+	/*
+
+	A compact stand-in for std::function, for widget callbacks.
+
+	A callback takes two pointers: one to a table of operations for
+	the type of callable it holds (null if the callback is empty), and
+	one for the callable itself. Callables which fit into a pointer -
+	function pointers, or lambdas which capture just a pointer, like
+	[this] - are stored in place, and never allocate. Larger ones are
+	kept on the heap.
+
+	Assign lambdas, std::bind expressions, std::functions or nullptr,
+	test for emptiness, and call, just like with std::function.
+	Calling an empty callback is not allowed.
+
+	*/
+
+	union Storage {
+		void* heap;
+		typename std::aligned_storage<sizeof(void*), alignof(void*)>::type local;
+	};
+
+	struct Ops {
+		R    (*invoke)(const Storage& storage_, Args... args_);
+		void (*copy)(Storage& dst_, const Storage& src_);
+		void (*destroy)(Storage& storage_);
+	};
+
+	template<typename F>
+	struct isLocal : std::integral_constant<bool,
+		sizeof(F) <= sizeof(Storage) && alignof(F) <= alignof(Storage) && std::is_trivially_copyable<F>::value> {
+	};
+
+	template<typename F>
+	struct LocalOps {
+		static R invoke(const Storage& storage_, Args... args_) {
+			return (*const_cast<F*>(reinterpret_cast<const F*>(&storage_.local)))(std::forward<Args>(args_)...);
+		}
+		static void copy(Storage& dst_, const Storage& src_) {
+			dst_ = src_;
+		}
+		static void destroy(Storage&) {
+		}
+		static const Ops ops;
+	};
+
+	template<typename F>
+	struct HeapOps {
+		static R invoke(const Storage& storage_, Args... args_) {
+			return (*static_cast<F*>(storage_.heap))(std::forward<Args>(args_)...);
+		}
+		static void copy(Storage& dst_, const Storage& src_) {
+			dst_.heap = new F(*static_cast<const F*>(src_.heap));
+		}
+		static void destroy(Storage& storage_) {
+			delete static_cast<F*>(storage_.heap);
+		}
+		static const Ops ops;
+	};
+
+	const Ops* mOps = nullptr;
+	Storage    mStorage{};
+
+	// a std::function or function pointer may be empty itself.
+	template<typename F>
+	static bool isEmpty(const F&) {
+		return false;
+	}
+	template<typename S>
+	static bool isEmpty(const std::function<S>& f_) {
+		return !f_;
+	}
+	template<typename T>
+	static bool isEmpty(T* f_) {
+		return f_ == nullptr;
+	}
+
+	template<typename F>
+	void assign(F&& f_, std::true_type /* isLocal */) {
+		new (&mStorage.local) typename std::decay<F>::type(std::forward<F>(f_));
+		mOps = &LocalOps<typename std::decay<F>::type>::ops;
+	}
+
+	template<typename F>
+	void assign(F&& f_, std::false_type /* isLocal */) {
+		mStorage.heap = new typename std::decay<F>::type(std::forward<F>(f_));
+		mOps = &HeapOps<typename std::decay<F>::type>::ops;
+	}
+
+public:
+
+	ofxWidgetCallback() = default;
+
+	ofxWidgetCallback(std::nullptr_t) {
+	}
+
+	template<typename F, typename = typename std::enable_if<
+		!std::is_same<typename std::decay<F>::type, ofxWidgetCallback>::value>::type>
+	ofxWidgetCallback(F&& f_) {
+		if (isEmpty(f_))
+			return;
+		assign(std::forward<F>(f_), isLocal<typename std::decay<F>::type>());
+	}
+
+	ofxWidgetCallback(const ofxWidgetCallback& rhs_)
+		: mOps(rhs_.mOps) {
+		if (mOps)
+			mOps->copy(mStorage, rhs_.mStorage);
+	}
+
+	ofxWidgetCallback(ofxWidgetCallback&& rhs_)
+		: mOps(rhs_.mOps)
+		, mStorage(rhs_.mStorage) {
+		// local callables are trivially copyable, and heap
+		// callables change hands - either way, rhs_ is done.
+		rhs_.mOps = nullptr;
+	}
+
+	~ofxWidgetCallback() {
+		if (mOps)
+			mOps->destroy(mStorage);
+	}
+
+	ofxWidgetCallback& operator=(const ofxWidgetCallback& rhs_) {
+		if (this != &rhs_)
+			ofxWidgetCallback(rhs_).swap(*this);
+		return *this;
+	}
+
+	ofxWidgetCallback& operator=(ofxWidgetCallback&& rhs_) {
+		ofxWidgetCallback(std::move(rhs_)).swap(*this);
+		return *this;
+	}
+
+	ofxWidgetCallback& operator=(std::nullptr_t) {
+		ofxWidgetCallback().swap(*this);
+		return *this;
+	}
+
+	template<typename F, typename = typename std::enable_if<
+		!std::is_same<typename std::decay<F>::type, ofxWidgetCallback>::value>::type>
+	ofxWidgetCallback& operator=(F&& f_) {
+		ofxWidgetCallback(std::forward<F>(f_)).swap(*this);
+		return *this;
+	}
+
+	void swap(ofxWidgetCallback& rhs_) {
+		std::swap(mOps, rhs_.mOps);
+		std::swap(mStorage, rhs_.mStorage);
+	}
+
+	explicit operator bool() const {
+		return mOps != nullptr;
+	}
+
+	R operator()(Args... args_) const {
+		return mOps->invoke(mStorage, std::forward<Args>(args_)...);
+	}
+};
+
+// ----------------------------------------------------------------------
+
+template<typename R, typename ... Args>
+template<typename F>
+const typename ofxWidgetCallback<R(Args...)>::Ops ofxWidgetCallback<R(Args...)>::LocalOps<F>::ops = {
+	&LocalOps<F>::invoke, &LocalOps<F>::copy, &LocalOps<F>::destroy
+};
+
+template<typename R, typename ... Args>
+template<typename F>
+const typename ofxWidgetCallback<R(Args...)>::Ops ofxWidgetCallback<R(Args...)>::HeapOps<F>::ops = {
+	&HeapOps<F>::invoke, &HeapOps<F>::copy, &HeapOps<F>::destroy
+};
+
+// ----------------------------------------------------------------------
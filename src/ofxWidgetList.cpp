@@ -0,0 +1,294 @@
+#include "ofxWidgetList.h"
+#include <algorithm>
+#include <cmath>
+// ----------------------------------------------------------------------
+/*
+   _____    ___
+  /    /   /  /     ofxWidget
+ /  __/ * /  /__    (c) ponies & light ltd., 2015-2016.
+/__/     /_____/    poniesandlight.co.uk
+
+ofxWidget
+Created by @tgfrerer 2015.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+// ----------------------------------------------------------------------
+
+ofxWidgetList::ofxWidgetList() {
+}
+
+// ----------------------------------------------------------------------
+
+ofxWidgetList::~ofxWidgetList() {
+	// the canvas (and any row widgets) may outlive the list, since 
+	// getWidget() and onBindRow hand out shared_ptrs to them - make 
+	// sure they don't call back into a list which is gone.
+	mCanvas->onUpdate = nullptr;
+	mCanvas->onMouse = nullptr;
+	for (auto & rw : mRowWidgets) {
+		rw.widget->onMouse = nullptr;
+	}
+	for (auto & w : mPool) {
+		w->onMouse = nullptr;
+	}
+}
+
+// ----------------------------------------------------------------------
+// lists may only be created through this factory function, since
+// the list's widgets hold on to the list's address.
+std::shared_ptr<ofxWidgetList> ofxWidgetList::make(const ofRectangle & rect_) {
+	auto list = std::shared_ptr<ofxWidgetList>(new ofxWidgetList());
+	auto l = list.get();
+
+	list->mCanvas = ofxWidget::make(rect_);
+	list->mCanvas->setClipChildren(true); // rows above and below the view are bound, but mustn't be seen.
+	list->mCanvas->onUpdate = [l]() {
+		l->update();
+	};
+	list->mCanvas->onMouse = [l](ofMouseEventArgs& args_) {
+		l->mouseEvent(args_);
+	};
+	return list;
+}
+
+// ----------------------------------------------------------------------
+
+float ofxWidgetList::getHeightOf(size_t row_) const {
+	return std::max(onRowHeight ? onRowHeight(row_) : mRowHeight, 1.f);
+}
+
+// ----------------------------------------------------------------------
+
+void ofxWidgetList::setNumRows(size_t numRows_) {
+	mNumRows = numRows_;
+	mFirstRow = std::min(mFirstRow, (mNumRows == 0 ? 0 : mNumRows - 1));
+	applyScroll(0.f);
+	invalidate(); // rows might now hold different data
+}
+
+// ----------------------------------------------------------------------
+
+void ofxWidgetList::setRowHeight(float rowHeight_) {
+	mRowHeight = rowHeight_;
+	bLayoutDirty = true;
+}
+
+// ----------------------------------------------------------------------
+
+void ofxWidgetList::setOverscan(size_t numRows_) {
+	mOverscan = numRows_;
+	bLayoutDirty = true;
+}
+
+// ----------------------------------------------------------------------
+
+void ofxWidgetList::setSmoothing(float smoothing_) {
+	mSmoothing = std::max(std::min(smoothing_, 1.f), 0.01f);
+}
+
+// ----------------------------------------------------------------------
+
+void ofxWidgetList::scrollBy(float pixels_) {
+	mPendingScroll += pixels_;
+}
+
+// ----------------------------------------------------------------------
+
+void ofxWidgetList::scrollToRow(size_t row_) {
+	mFirstRow = std::min(row_, (mNumRows == 0 ? 0 : mNumRows - 1));
+	mFirstRowOffset = 0.f;
+	mPendingScroll = 0.f;
+	applyScroll(0.f);
+}
+
+// ----------------------------------------------------------------------
+
+const float ofxWidgetList::getScrollPosition() const {
+	if (mNumRows == 0)
+		return 0.f;
+	// we estimate the number of rows in view from the height of 
+	// the first row - this is exact if all rows have the same height.
+	auto firstRowHeight = getHeightOf(mFirstRow);
+	auto rowsInView = mCanvas->getRect().height / firstRowHeight;
+	auto maxPosition = std::max(float(mNumRows) - rowsInView, 1.f);
+	return std::min((mFirstRow + mFirstRowOffset / firstRowHeight) / maxPosition, 1.f);
+}
+
+// ----------------------------------------------------------------------
+
+void ofxWidgetList::invalidate() {
+	for (auto & rw : mRowWidgets) {
+		rw.widget->setVisibility(false);
+		mPool.push_back(std::move(rw.widget));
+	}
+	mRowWidgets.clear();
+	bLayoutDirty = true;
+}
+
+// ----------------------------------------------------------------------
+
+void ofxWidgetList::applyScroll(float delta_) {
+
+	// all walks here are bounded by the distance scrolled, plus 
+	// the number of rows in view - never by the number of rows.
+
+	mFirstRowOffset += delta_;
+
+	while (mFirstRowOffset < 0.f && mFirstRow > 0) {
+		mFirstRowOffset += getHeightOf(--mFirstRow);
+	}
+	while (mFirstRow + 1 < mNumRows && mFirstRowOffset >= getHeightOf(mFirstRow)) {
+		mFirstRowOffset -= getHeightOf(mFirstRow++);
+	}
+
+	// don't scroll past the end of the list: if the rows below the 
+	// top of the view don't fill the view, scroll back up.
+	auto viewHeight = mCanvas->getRect().height;
+	auto filled = -mFirstRowOffset;
+	for (auto r = mFirstRow; r < mNumRows && filled < viewHeight; ++r) {
+		filled += getHeightOf(r);
+	}
+	if (filled < viewHeight) {
+		mFirstRowOffset -= (viewHeight - filled);
+		while (mFirstRowOffset < 0.f && mFirstRow > 0) {
+			mFirstRowOffset += getHeightOf(--mFirstRow);
+		}
+		mPendingScroll = std::min(mPendingScroll, 0.f);
+	}
+
+	// ... nor past its beginning.
+	if (mFirstRowOffset < 0.f) {
+		mFirstRowOffset = 0.f;
+		mPendingScroll = std::max(mPendingScroll, 0.f);
+	}
+
+	bLayoutDirty = true;
+}
+
+// ----------------------------------------------------------------------
+
+void ofxWidgetList::layout() {
+
+	const auto & rect = mCanvas->getRect();
+	mLayoutRect = rect;
+	bLayoutDirty = false;
+
+	// find range of rows [first, last) to bind: rows in view, plus overscan.
+
+	auto first = mFirstRow - std::min(mFirstRow, mOverscan);
+	auto firstY = rect.y - mFirstRowOffset;
+	for (auto r = mFirstRow; r > first; ) {
+		firstY -= getHeightOf(--r);
+	}
+
+	auto last = mFirstRow;
+	for (auto y = rect.y - mFirstRowOffset; last < mNumRows && y < rect.getBottom(); ) {
+		y += getHeightOf(last++);
+	}
+	last = std::min(mNumRows, last + mOverscan);
+
+	// widgets for rows which left the range go back into the pool.
+
+	auto outOfRange = std::stable_partition(mRowWidgets.begin(), mRowWidgets.end(), [first, last](const RowWidget& rw) {
+		return rw.row >= first && rw.row < last;
+	});
+	for (auto it = outOfRange; it != mRowWidgets.end(); ++it) {
+		it->widget->setVisibility(false);
+		mPool.push_back(std::move(it->widget));
+	}
+	mRowWidgets.erase(outOfRange, mRowWidgets.end());
+
+	// now lay out all rows in range - re-using widgets which already 
+	// show a row, and binding pooled (or new) widgets for all others.
+
+	std::vector<RowWidget> rowWidgets;
+	rowWidgets.reserve(last - first);
+
+	auto kept = mRowWidgets.begin();
+	auto y = firstY;
+
+	for (auto r = first; r < last; ++r) {
+		ofRectangle rowRect(rect.x, y, rect.width, getHeightOf(r));
+		y += rowRect.height;
+
+		if (kept != mRowWidgets.end() && kept->row == r) {
+			kept->widget->setRect(rowRect);
+			rowWidgets.push_back(std::move(*kept++));
+			continue;
+		}
+
+		std::shared_ptr<ofxWidget> w;
+		if (!mPool.empty()) {
+			w = std::move(mPool.back());
+			mPool.pop_back();
+			w->setRect(rowRect);
+			w->setVisibility(true);
+		} else {
+			ofxWidgetContext::Scope scope(mCanvas->getContext()); // rows live in the list's context
+			w = ofxWidget::make(rowRect);
+			w->setParent(mCanvas);
+		}
+
+		// forget whatever the widget did for its previous row. by 
+		// default, rows pass scroll events on to the list.
+		w->onDraw = nullptr;
+		w->onUpdate = nullptr;
+		w->onKey = nullptr;
+		w->onTouch = nullptr;
+		w->onFocusEnter = nullptr;
+		w->onFocusLeave = nullptr;
+		w->onMouseEnter = nullptr;
+		w->onMouseLeave = nullptr;
+		w->onMouse = [this](ofMouseEventArgs& args_) {
+			mouseEvent(args_);
+		};
+
+		rowWidgets.push_back({ r, w });
+		if (onBindRow)
+			onBindRow(r, rowWidgets.back().widget);
+	}
+
+	mRowWidgets = std::move(rowWidgets);
+}
+
+// ----------------------------------------------------------------------
+
+void ofxWidgetList::update() {
+	if (mPendingScroll != 0.f) {
+		auto step = (std::abs(mPendingScroll) <= 0.5f ? mPendingScroll : mPendingScroll * mSmoothing);
+		mPendingScroll -= step;
+		applyScroll(step);
+	}
+	if (bLayoutDirty || mCanvas->getRect() != mLayoutRect)
+		layout();
+}
+
+// ----------------------------------------------------------------------
+
+bool ofxWidgetList::mouseEvent(ofMouseEventArgs & args_) {
+	if (args_.type == ofMouseEventArgs::Scrolled) {
+		// scroll by three (default height) rows per wheel notch
+		scrollBy(-args_.scrollY * 3.f * mRowHeight);
+		return true;
+	}
+	return false;
+}
+
+// ----------------------------------------------------------------------
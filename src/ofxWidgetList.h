@@ -0,0 +1,133 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <vector>
+#include "ofxWidget.h"
+/*
+   _____    ___
+  /    /   /  /     ofxWidget
+ /  __/ * /  /__    (c) ponies & light ltd., 2015-2016.
+/__/     /_____/    poniesandlight.co.uk
+
+ofxWidget
+Created by @tgfrerer 2015.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+// ----------------------------------------------------------------------
+
+class ofxWidgetList {
+
+	/*
+
+	A vertically scrolling list, for lists of (very) many rows.
+
+	The list only keeps widgets for the rows which are currently in 
+	view, plus a few rows of overscan above and below. Once a row 
+	scrolls out of view, its widget goes back into a pool, from which 
+	it gets recycled for the next row to scroll into view. This means 
+	memory and per-frame cost depend on how many rows are visible, 
+	and not on how many rows there are.
+
+	Whenever a widget gets assigned to a row, onBindRow is called, 
+	which is where you set up the widget's callbacks for that row.
+
+	Rows may differ in height. Heights are asked for only for rows 
+	near the view, so they may just as well be estimates. The scroll 
+	position is kept as a row, plus an offset into that row.
+
+	*/
+
+	struct RowWidget {
+		size_t row;
+		std::shared_ptr<ofxWidget> widget;
+	};
+
+	std::shared_ptr<ofxWidget> mCanvas;		// clips, and scrolls its row widgets
+	std::vector<RowWidget> mRowWidgets;		// widgets for rows in view (plus overscan), ordered by row
+	std::vector<std::shared_ptr<ofxWidget>> mPool; // hidden widgets, ready for re-use
+
+	size_t mNumRows = 0;
+	float  mRowHeight = 20.f;			// height for rows if there is no onRowHeight
+	size_t mOverscan = 2;				// rows to keep ready above and below the view
+
+	size_t mFirstRow = 0;				// row at the top of the view
+	float  mFirstRowOffset = 0.f;		// how far the first row is scrolled out of the top of the view
+	float  mPendingScroll = 0.f;		// scroll distance still to travel, in pixels
+	float  mSmoothing = 0.25f;			// fraction of pending scroll distance travelled per frame
+
+	ofRectangle mLayoutRect;			// canvas rect at last layout
+	bool bLayoutDirty = true;
+
+	ofxWidgetList();
+
+	float getHeightOf(size_t row_) const;
+	void applyScroll(float delta_);
+	void layout();
+	void update();
+	bool mouseEvent(ofMouseEventArgs& args_);
+
+public:
+
+	~ofxWidgetList();
+
+	std::function<void(size_t row_, std::shared_ptr<ofxWidget>& widget_)> onBindRow; //< Called whenever widget_ is assigned to row_. Set up the widget's callbacks for this row here.
+	std::function<float(size_t row_)> onRowHeight; //< Optional: return the height (or an estimate of it) for row_.
+
+	void setNumRows(size_t numRows_);	//< Set the number of rows in the list
+	const size_t getNumRows() const;
+
+	void setRowHeight(float rowHeight_);//< Set the height of all rows, unless there is an onRowHeight callback
+	void setOverscan(size_t numRows_);	//< Set how many rows above and below the view are kept bound
+	void setSmoothing(float smoothing_);//< Set fraction of remaining scroll distance travelled per frame - 1 means scrolling jumps right away
+
+	void scrollBy(float pixels_);		//< Scroll smoothly by pixels_ - positive values scroll down the list
+	void scrollToRow(size_t row_);		//< Jump, so that row_ is at the top of the view
+
+	const size_t getFirstVisibleRow() const;	//< Return the row at the top of the view
+	const float getScrollPosition() const;		//< Return approximate scroll position, from 0 (top) to 1 (bottom)
+	const size_t getNumRowWidgets() const;		//< Return number of widgets the list holds - bound and pooled
+
+	void invalidate();					//< Re-bind all rows in view, say, because the list data has changed
+
+	std::shared_ptr<ofxWidget>& getWidget();	//< Return the list's widget - use this to position or parent the list
+public:
+	static std::shared_ptr<ofxWidgetList> make(const ofRectangle& rect_);
+};
+
+// ----------------------------------------------------------------------
+
+inline const size_t ofxWidgetList::getNumRows() const {
+	return mNumRows;
+}
+
+inline const size_t ofxWidgetList::getFirstVisibleRow() const {
+	return mFirstRow;
+}
+
+inline const size_t ofxWidgetList::getNumRowWidgets() const {
+	return mRowWidgets.size() + mPool.size();
+}
+
+inline std::shared_ptr<ofxWidget>& ofxWidgetList::getWidget() {
+	return mCanvas;
+}
+
+// ----------------------------------------------------------------------
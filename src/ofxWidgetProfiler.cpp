@@ -0,0 +1,329 @@
+#include "ofxWidgetProfiler.h"
+#include "ofLog.h"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <unordered_map>
+// ----------------------------------------------------------------------
+/*
+   _____    ___
+  /    /   /  /     ofxWidget
+ /  __/ * /  /__    (c) ponies & light ltd., 2015-2016.
+/__/     /_____/    poniesandlight.co.uk
+
+ofxWidget
+Created by @tgfrerer 2015.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+// ----------------------------------------------------------------------
+
+std::atomic<bool> ofxWidgetProfiler::bEnabled(false);
+
+namespace {
+
+	struct TraceEvent {
+		uint64_t                    contextId;
+		ofxWidgetHandle             handle;
+		ofxWidgetProfiler::Callback callback;
+		uint64_t                    startNs;
+		uint64_t                    durationNs;
+	};
+
+	struct Accumulator {
+		uint64_t count   = 0;
+		uint64_t totalNs = 0;
+		uint64_t maxNs   = 0;
+	};
+
+	// widgets are told apart by context and handle - handles of 
+	// widgets in different contexts may well be the same. contexts 
+	// go by id, since a new context might get the address of one 
+	// which is gone.
+	struct Key {
+		uint64_t contextId;
+		uint64_t handle;
+
+		bool operator==(const Key& rhs_) const {
+			return contextId == rhs_.contextId && handle == rhs_.handle;
+		}
+	};
+
+	struct KeyHash {
+		size_t operator()(const Key& key_) const {
+			return std::hash<uint64_t>()(key_.contextId) ^ std::hash<uint64_t>()(key_.handle * 0x9e3779b97f4a7c15ull);
+		}
+	};
+
+	Key key(uint64_t contextId_, const ofxWidgetHandle& h_) {
+		return { contextId_, (uint64_t(h_.index) << 32) | h_.generation };
+	}
+
+	ofxWidgetHandle handleFromKey(const Key& key_) {
+		ofxWidgetHandle h;
+		h.index = uint32_t(key_.handle >> 32);
+		h.generation = uint32_t(key_.handle);
+		return h;
+	}
+
+	// contexts may record from separate threads: all profiler state
+	// below is guarded by sMutex.
+	std::mutex sMutex;
+
+	std::vector<TraceEvent> sTraceEvents;
+	size_t   sMaxTraceEvents = size_t(1) << 20;
+	uint64_t sNumDroppedTraceEvents = 0;
+	uint64_t sEpochNs = 0; // trace timestamps are relative to this
+
+	std::unordered_map<Key, std::array<Accumulator, ofxWidgetProfiler::NumCallbacks>, KeyHash> sAccumulators;
+
+	// names are kept by handle, so that they outlive their widgets 
+	// for as long as we might want to export traces.
+	std::unordered_map<Key, std::string, KeyHash> sNames;
+
+	// ----------------------------------------------------------------------
+
+	std::string nameOf(uint64_t contextId_, const ofxWidgetHandle& handle_) {
+		// sMutex must be held.
+		if (!handle_.isValid())
+			return "ofxWidget";
+		auto it = sNames.find(key(contextId_, handle_));
+		if (it != sNames.end())
+			return it->second;
+		return "#" + std::to_string(handle_.index) + ":" + std::to_string(handle_.generation);
+	}
+
+	// ----------------------------------------------------------------------
+
+	std::string escapeJson(const std::string& str_) {
+		std::string result;
+		result.reserve(str_.size());
+		for (auto c : str_) {
+			switch (c) {
+			case '"':  result += "\\\""; break;
+			case '\\': result += "\\\\"; break;
+			case '\n': result += "\\n"; break;
+			case '\t': result += "\\t"; break;
+			default:
+				if (static_cast<unsigned char>(c) < 0x20) {
+					char buf[8];
+					snprintf(buf, sizeof(buf), "\\u%04x", c);
+					result += buf;
+				} else {
+					result += c;
+				}
+			}
+		}
+		return result;
+	}
+
+} // end anonymous namespace
+
+// ----------------------------------------------------------------------
+
+void ofxWidgetProfiler::setEnabled(bool enabled_) {
+	std::lock_guard<std::mutex> lock(sMutex);
+	if (enabled_ && !bEnabled && sTraceEvents.empty())
+		sEpochNs = now();
+	bEnabled = enabled_;
+}
+
+// ----------------------------------------------------------------------
+
+void ofxWidgetProfiler::setMaxEvents(size_t maxEvents_) {
+	std::lock_guard<std::mutex> lock(sMutex);
+	sMaxTraceEvents = maxEvents_;
+	if (sTraceEvents.size() > sMaxTraceEvents) {
+		sNumDroppedTraceEvents += sTraceEvents.size() - sMaxTraceEvents;
+		sTraceEvents.resize(sMaxTraceEvents);
+	}
+}
+
+// ----------------------------------------------------------------------
+
+void ofxWidgetProfiler::clear() {
+	std::lock_guard<std::mutex> lock(sMutex);
+	sTraceEvents.clear();
+	sAccumulators.clear();
+	sNumDroppedTraceEvents = 0;
+	sEpochNs = now();
+}
+
+// ----------------------------------------------------------------------
+
+void ofxWidgetProfiler::setName(const std::shared_ptr<ofxWidget>& widget_, const std::string& name_) {
+	if (!widget_)
+		return;
+	std::lock_guard<std::mutex> lock(sMutex);
+	sNames[key(widget_->getContext().getId(), widget_->getHandle())] = name_;
+}
+
+// ----------------------------------------------------------------------
+
+std::string ofxWidgetProfiler::getName(const ofxWidgetHandle& handle_, const ofxWidgetContext& context_) {
+	std::lock_guard<std::mutex> lock(sMutex);
+	return nameOf(context_.getId(), handle_);
+}
+
+// ----------------------------------------------------------------------
+
+const char* ofxWidgetProfiler::getCallbackName(Callback callback_) {
+	switch (callback_) {
+	case Update:     return "onUpdate";
+	case Draw:       return "onDraw";
+	case Mouse:      return "onMouse";
+	case Key:        return "onKey";
+	case FocusEnter: return "onFocusEnter";
+	case FocusLeave: return "onFocusLeave";
+	case MouseEnter: return "onMouseEnter";
+	case MouseLeave: return "onMouseLeave";
+	case Touch:      return "onTouch";
+	case UpdatePass: return "update";
+	case DrawPass:   return "draw";
+	default:         return "unknown";
+	}
+}
+
+// ----------------------------------------------------------------------
+
+void ofxWidgetProfiler::record(uint64_t contextId_, const ofxWidgetHandle& handle_, Callback callback_, uint64_t startNs_, uint64_t endNs_) {
+
+	auto duration = endNs_ - startNs_;
+
+	std::lock_guard<std::mutex> lock(sMutex);
+
+	auto & acc = sAccumulators[key(contextId_, handle_)][callback_];
+	++acc.count;
+	acc.totalNs += duration;
+	acc.maxNs = std::max(acc.maxNs, duration);
+
+	if (sTraceEvents.size() < sMaxTraceEvents) {
+		sTraceEvents.push_back({ contextId_, handle_, callback_, startNs_, duration });
+	} else {
+		++sNumDroppedTraceEvents;
+	}
+}
+
+// ----------------------------------------------------------------------
+
+std::vector<ofxWidgetProfiler::Stats> ofxWidgetProfiler::getStats() {
+
+	std::vector<Stats> result;
+
+	std::unique_lock<std::mutex> lock(sMutex);
+
+	for (const auto & a : sAccumulators) {
+		for (int c = 0; c != NumCallbacks; ++c) {
+			const auto & acc = a.second[c];
+			if (acc.count == 0)
+				continue;
+			Stats s;
+			s.contextId = a.first.contextId;
+			s.handle = handleFromKey(a.first);
+			s.name = nameOf(s.contextId, s.handle);
+			s.callback = Callback(c);
+			s.count = acc.count;
+			s.totalNs = acc.totalNs;
+			s.maxNs = acc.maxNs;
+			result.push_back(s);
+		}
+	}
+
+	lock.unlock();
+
+	std::sort(result.begin(), result.end(), [](const Stats& lhs, const Stats& rhs) {
+		return lhs.totalNs > rhs.totalNs;
+	});
+
+	return result;
+}
+
+// ----------------------------------------------------------------------
+
+void ofxWidgetProfiler::writeStats(std::ostream & os_, size_t maxRows_) {
+
+	auto stats = getStats();
+
+	char line[256];
+	snprintf(line, sizeof(line), "%-32s %-14s %10s %14s %12s %12s\n", "widget", "callback", "count", "total [us]", "mean [us]", "max [us]");
+	os_ << line;
+
+	for (size_t i = 0; i < stats.size() && i < maxRows_; ++i) {
+		const auto & s = stats[i];
+		snprintf(line, sizeof(line), "%-32s %-14s %10llu %14.1f %12.2f %12.2f\n",
+			s.name.substr(0, 32).c_str(),
+			getCallbackName(s.callback),
+			(unsigned long long)s.count,
+			s.totalNs * 1e-3,
+			s.getMeanNs() * 1e-3,
+			s.maxNs * 1e-3);
+		os_ << line;
+	}
+}
+
+// ----------------------------------------------------------------------
+
+void ofxWidgetProfiler::writeChromeTrace(std::ostream & os_) {
+
+	// see: "Trace Event Format" - we write complete events ("ph":"X"),
+	// with timestamps and durations in microseconds.
+
+	os_ << "{\"traceEvents\":[\n";
+
+	char buf[128];
+	bool isFirst = true;
+
+	std::lock_guard<std::mutex> lock(sMutex);
+
+	for (const auto & e : sTraceEvents) {
+		if (!isFirst)
+			os_ << ",\n";
+		isFirst = false;
+
+		auto widgetName = escapeJson(nameOf(e.contextId, e.handle));
+
+		os_ << "{\"name\":\"" << widgetName << "." << getCallbackName(e.callback) << "\"";
+		os_ << ",\"cat\":\"" << (e.handle.isValid() ? "widget" : "pass") << "\"";
+		snprintf(buf, sizeof(buf), ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":%llu",
+			(e.startNs - std::min(e.startNs, sEpochNs)) * 1e-3,
+			e.durationNs * 1e-3,
+			(unsigned long long)e.contextId);
+		os_ << buf;
+		os_ << ",\"args\":{\"widget\":\"" << widgetName << "\"}}";
+	}
+
+	os_ << "\n],\"displayTimeUnit\":\"ns\"";
+	os_ << ",\"otherData\":{\"droppedEvents\":" << sNumDroppedTraceEvents << "}}\n";
+}
+
+// ----------------------------------------------------------------------
+
+bool ofxWidgetProfiler::saveChromeTrace(const std::string & path_) {
+	std::ofstream file(path_);
+	if (!file) {
+		ofLogError() << "Could not open file for writing: " << path_;
+		return false;
+	}
+	writeChromeTrace(file);
+	return true;
+}
+
+// ----------------------------------------------------------------------
@@ -0,0 +1,168 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "ofxWidget.h"
+/*
+   _____    ___
+  /    /   /  /     ofxWidget
+ /  __/ * /  /__    (c) ponies & light ltd., 2015-2016.
+/__/     /_____/    poniesandlight.co.uk
+
+ofxWidget
+Created by @tgfrerer 2015.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+// ----------------------------------------------------------------------
+
+class ofxWidgetProfiler {
+
+	/*
+
+	Records wall time for every widget callback, while enabled.
+
+	Recorded callbacks can be exported as Chrome trace events 
+	(load the file in chrome://tracing), and are aggregated into 
+	per-widget, per-callback statistics.
+
+	The profiler is off by default. While it is off, each callback 
+	costs one extra branch. Define OFX_WIDGET_NO_PROFILER to remove
+	the profiler from callback dispatch altogether.
+
+	There is one profiler for all widget contexts. Widgets are told 
+	apart by context id and handle, and recording is guarded by a 
+	lock, so contexts may be profiled while they run on separate 
+	threads. In Chrome traces, each context shows up as a thread of 
+	its own, with the context id as its thread id.
+
+	*/
+
+public:
+
+	enum Callback : uint8_t {
+		Update = 0,
+		Draw,
+		Mouse,
+		Key,
+		FocusEnter,
+		FocusLeave,
+		MouseEnter,
+		MouseLeave,
+		Touch,
+		UpdatePass,	// a full ofxWidget::update()
+		DrawPass,	// a full ofxWidget::draw()
+		NumCallbacks,
+	};
+
+	struct Stats {
+		uint64_t        contextId = 0;	// id of the widget's context, or of the pass's - see ofxWidgetContext::getId()
+		ofxWidgetHandle handle;		// widget, or invalid handle for passes
+		std::string     name;		// widget name, or "#index:generation" if the widget has no name
+		Callback        callback = Update;
+		uint64_t        count    = 0;
+		uint64_t        totalNs  = 0;
+		uint64_t        maxNs    = 0;
+
+		double getMeanNs() const {
+			return count ? double(totalNs) / double(count) : 0.;
+		}
+	};
+
+	class Scope {
+		// times a callback from construction to destruction.
+#ifndef OFX_WIDGET_NO_PROFILER
+		uint64_t        mContextId;
+		ofxWidgetHandle mHandle;
+		Callback        mCallback;
+		bool            bActive;
+		uint64_t        mStartNs;
+#endif
+	public:
+		Scope(const ofxWidgetContext& context_, const ofxWidgetHandle& handle_, Callback callback_);
+		~Scope();
+	};
+
+	static void setEnabled(bool enabled_);	//< start (or stop) recording
+	static bool isEnabled();
+
+	static void setMaxEvents(size_t maxEvents_);	//< Limit number of trace events kept in memory. Statistics keep accumulating once the limit is reached.
+	static void clear();							//< discard all trace events and statistics
+
+	static void setName(const std::shared_ptr<ofxWidget>& widget_, const std::string& name_); //< name a widget for traces and statistics
+	static std::string getName(const ofxWidgetHandle& handle_, const ofxWidgetContext& context_ = ofxWidgetContext::getCurrent());
+
+	static const char* getCallbackName(Callback callback_);
+
+	static std::vector<Stats> getStats();				//< per-widget, per-callback statistics, most expensive first
+	static void writeStats(std::ostream& os_, size_t maxRows_ = 20); //< write statistics as a text table
+
+	static void writeChromeTrace(std::ostream& os_);	//< write all recorded trace events as Chrome trace event JSON
+	static bool saveChromeTrace(const std::string& path_);
+
+private:
+
+	static std::atomic<bool> bEnabled;
+
+	static uint64_t now();
+	static void record(uint64_t contextId_, const ofxWidgetHandle& handle_, Callback callback_, uint64_t startNs_, uint64_t endNs_);
+};
+
+// ----------------------------------------------------------------------
+
+inline bool ofxWidgetProfiler::isEnabled() {
+	return bEnabled.load(std::memory_order_relaxed);
+}
+
+inline uint64_t ofxWidgetProfiler::now() {
+	return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+#ifndef OFX_WIDGET_NO_PROFILER
+
+inline ofxWidgetProfiler::Scope::Scope(const ofxWidgetContext& context_, const ofxWidgetHandle& handle_, Callback callback_)
+	: mContextId(context_.getId())
+	, mHandle(handle_)
+	, mCallback(callback_)
+	, bActive(isEnabled())
+	, mStartNs(bActive ? now() : 0) {
+}
+
+inline ofxWidgetProfiler::Scope::~Scope() {
+	if (bActive)
+		record(mContextId, mHandle, mCallback, mStartNs, now());
+}
+
+#else
+
+inline ofxWidgetProfiler::Scope::Scope(const ofxWidgetContext&, const ofxWidgetHandle&, Callback) {
+}
+
+inline ofxWidgetProfiler::Scope::~Scope() {
+}
+
+#endif
+
+// ----------------------------------------------------------------------